@@ -0,0 +1,56 @@
+#pragma once
+// Heap allocation counters. They only move when tests/alloc_hook.cpp, which
+// replaces the global operator new and delete, is linked into the binary (the
+// tests and bdd_bench targets with BDD_COUNT_ALLOCATIONS on). Elsewhere they
+// stay at zero and enabled() is false.
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+struct Alloc_Snapshot {
+    uint64_t allocations{};  // calls to operator new since startup
+    uint64_t bytes{};        // bytes requested since startup
+    int64_t live_bytes{};    // bytes currently allocated
+    int64_t peak_live_bytes{};
+};
+
+namespace alloc_stats {
+inline std::atomic<bool> hooked{};
+inline std::atomic<uint64_t> allocations{};
+inline std::atomic<uint64_t> bytes{};
+inline std::atomic<int64_t> live_bytes{};
+inline std::atomic<int64_t> peak_live_bytes{};
+
+inline bool enabled() { return hooked.load(std::memory_order_relaxed); }
+
+inline void record_allocation(const size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    const int64_t live =
+        live_bytes.fetch_add(static_cast<int64_t>(size),
+                             std::memory_order_relaxed) +
+        static_cast<int64_t>(size);
+    int64_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_live_bytes.compare_exchange_weak(
+                              peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+inline void record_free(const size_t size) {
+    live_bytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+}
+
+inline Alloc_Snapshot snapshot() {
+    return {allocations.load(std::memory_order_relaxed),
+            bytes.load(std::memory_order_relaxed),
+            live_bytes.load(std::memory_order_relaxed),
+            peak_live_bytes.load(std::memory_order_relaxed)};
+}
+
+// Restarts peak tracking from the current live heap, so that a later
+// snapshot's peak_live_bytes is the high-water mark since this call
+inline void reset_peak() {
+    peak_live_bytes.store(live_bytes.load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+}
+}  // namespace alloc_stats
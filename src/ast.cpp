@@ -1,5 +1,7 @@
 #include "ast.h"
 
+#include <new>
+
 std::string expr_repr(const expr& expression) {
     return std::visit(
         []<typename T0>(const T0& e) -> std::string {
@@ -7,7 +9,8 @@ std::string expr_repr(const expr& expression) {
             if constexpr (std::is_same_v<T, sub_expr>) {
                 std::string result = "SubExpr(";
                 for (const auto& [key, value] : e.substitutions) {
-                    result += key + " -> " + expr_repr(*value) + ", ";
+                    result += std::string(Symbol_Table::instance().name(key)) +
+                              " -> " + expr_repr(*value) + ", ";
                 }
                 result.pop_back();  // Remove last space
                 result.pop_back();  // Remove last comma
@@ -15,14 +18,15 @@ std::string expr_repr(const expr& expression) {
                 return result;
 
             } else if constexpr (std::is_same_v<T, bin_expr>) {
-                return "BinExpr(" + expr_repr(*e.left) + ", " + e.op.lexeme +
-                       ", " + expr_repr(*e.right) + ")";
+                return "BinExpr(" + expr_repr(*e.left) + ", " +
+                       std::string(e.op.lexeme) + ", " + expr_repr(*e.right) +
+                       ")";
 
             } else if constexpr (std::is_same_v<T, quantifier_expr>) {
                 std::string result =
-                    "QuantifierExpr(" + e.quantifier.lexeme + " (";
+                    "QuantifierExpr(" + std::string(e.quantifier.lexeme) + " (";
                 for (const auto& id : e.bound_vars) {
-                    result += id.lexeme + ", ";
+                    result += std::string(id.lexeme) + ", ";
                 }
                 result.pop_back();  // Remove last space
                 result.pop_back();  // Remove last comma
@@ -30,12 +34,18 @@ std::string expr_repr(const expr& expression) {
                 result += expr_repr(*e.body) + ")";
                 return result;
             } else if constexpr (std::is_same_v<T, unary_expr>) {
-                return "UnaExpr(" + e.op.lexeme + ", " + expr_repr(*e.operand) +
-                       ")";
+                return "UnaExpr(" + std::string(e.op.lexeme) + ", " +
+                       expr_repr(*e.operand) + ")";
             } else if constexpr (std::is_same_v<T, literal>) {
-                return "Literal(" + e.value.lexeme + ")";
+                return "Literal(" + std::string(e.value.lexeme) + ")";
             } else if constexpr (std::is_same_v<T, identifier>) {
-                return "Identifier(" + e.name.lexeme + ")";
+                return "Identifier(" + std::string(e.name.lexeme) + ")";
+            } else if constexpr (std::is_same_v<T, nary_expr>) {
+                std::string result = "NaryExpr(" + std::string(e.op.lexeme);
+                for (const auto& operand : e.operands) {
+                    result += ", " + expr_repr(*operand);
+                }
+                return result + ")";
             } else {
                 return "Unknown Expression Type";
             }
@@ -51,7 +61,7 @@ std::string stmt_repr(const stmt& statement) {
                 return "Expr_Stmt(" + expr_repr(*s.expression) + ")";
             } else if constexpr (std::is_same_v<T, func_call_stmt>) {
                 std::string result =
-                    "Func_Call_Stmt(" + s.func_name.lexeme + "(";
+                    "Func_Call_Stmt(" + std::string(s.func_name.lexeme) + "(";
                 for (const auto& arg : s.arguments) {
                     result += expr_repr(*arg) + ", ";
                 }
@@ -64,7 +74,7 @@ std::string stmt_repr(const stmt& statement) {
             } else if constexpr (std::is_same_v<T, decl_stmt>) {
                 std::string result = "Decl_Stmt(";
                 for (const auto& id : s.identifiers) {
-                    result += id.lexeme + ", ";
+                    result += std::string(id.lexeme) + ", ";
                 }
                 result.pop_back();  // Remove last space
                 result.pop_back();  // Remove last comma
@@ -72,7 +82,7 @@ std::string stmt_repr(const stmt& statement) {
                 return result;
             } else if constexpr (std::is_same_v<T, assign_stmt>) {
                 std::string result = "Assign_Stmt(";
-                result += "Target: " + expr_repr(*s.target) + ", ";
+                result += "Target: " + expr_repr(s.target) + ", ";
                 result += "Value: " + expr_repr(*s.value) + ")";
                 return result;
             } else {
@@ -81,3 +91,85 @@ std::string stmt_repr(const stmt& statement) {
         },
         statement);
 }
+
+std::string stmt_summary(const stmt& statement) {
+    // Unlike stmt_repr, this never expands expressions so it stays cheap and
+    // short even for statements with huge ASTs
+    return std::visit(
+        []<typename T0>(const T0& s) -> std::string {
+            using T = std::remove_cvref_t<T0>;
+            if constexpr (std::is_same_v<T, expr_stmt>) {
+                return "<expr>";
+            } else if constexpr (std::is_same_v<T, func_call_stmt>) {
+                std::string result(s.func_name.lexeme);
+                if (s.arguments.empty()) return result;
+                const expr& arg = *s.arguments[0];
+                if (const auto* id = std::get_if<identifier>(&arg)) {
+                    result += " " + std::string(id->name.lexeme);
+                } else if (const auto* lit = std::get_if<literal>(&arg);
+                           lit != nullptr &&
+                           lit->value.type == token::Type::STRING) {
+                    result += " \"" + std::string(lit->value.lexeme) + "\"";
+                }
+                return result;
+            } else if constexpr (std::is_same_v<T, decl_stmt>) {
+                std::string result = "bvar";
+                for (const auto& id : s.identifiers) {
+                    result += " " + std::string(id.lexeme);
+                }
+                return result;
+            } else if constexpr (std::is_same_v<T, assign_stmt>) {
+                return "set " + std::string(s.target.name.lexeme);
+            } else {
+                return "<unknown>";
+            }
+        },
+        statement);
+}
+
+Ast_Arena::Ast_Arena(Ast_Arena&& other) noexcept
+    : blocks(std::move(other.blocks)),
+      used(std::exchange(other.used, block_size)),
+      consed(std::move(other.consed)),
+      texts(std::move(other.texts)) {}
+
+Ast_Arena& Ast_Arena::operator=(Ast_Arena&& other) noexcept {
+    if (this != &other) {
+        clear();
+        blocks = std::move(other.blocks);
+        used = std::exchange(other.used, block_size);
+        consed = std::move(other.consed);
+        texts = std::move(other.texts);
+    }
+    return *this;
+}
+
+const expr* Ast_Arena::make(literal node) {
+    token& value = node.value;
+    if (value.type == token::Type::STRING) {
+        value.lexeme = texts.emplace_back(value.lexeme);
+        return allocate(std::move(node));
+    }
+    const Cons_Key key = key_of(node);
+    if (const auto it = consed.find(key); it != consed.end()) {
+        return it->second;
+    }
+    if (value.type == token::Type::ID) {
+        value.lexeme = texts.emplace_back(value.lexeme);
+    }
+    return consed[key] = allocate(std::move(node));
+}
+
+void Ast_Arena::clear() {
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const size_t count = b + 1 == blocks.size() ? used : block_size;
+        for (size_t i = 0; i < count; ++i) {
+            std::destroy_at(
+                std::launder(reinterpret_cast<expr*>(blocks[b][i].bytes)));
+        }
+    }
+    blocks.clear();
+    used = block_size;
+    consed.clear();
+    texts.clear();
+}
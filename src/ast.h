@@ -1,42 +1,52 @@
 #pragma once
+#include <cstddef>
+#include <deque>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <utility>
 #include <variant>
+#include <vector>
 
+#include "absl/hash/hash.h"
 #include "lexer.h"
 #include "token.h"
 
 // Expressions
+// Nodes are owned by an Ast_Arena and refer to their children by pointer, so
+// an expression is only valid while its arena is alive
 struct sub_expr;
 struct bin_expr;
 struct unary_expr;
 struct literal;
 struct identifier;
 struct quantifier_expr;
+struct nary_expr;
 
 using expr = std::variant<sub_expr, bin_expr, quantifier_expr, unary_expr,
-                          literal, identifier>;
+                          literal, identifier, nary_expr>;
 
-using substitution_map = std::unordered_map<std::string, std::shared_ptr<expr>>;
+// Keyed by the symbol of the substituted variable
+using substitution_map = std::unordered_map<symbol_id, const expr*>;
 struct sub_expr {
     substitution_map substitutions;
-    std::shared_ptr<expr> body;
+    const expr* body;
 };
 
 struct bin_expr {
-    std::shared_ptr<expr> left;
-    std::shared_ptr<expr> right;
+    const expr* left;
+    const expr* right;
     token op;
 };
 
 struct quantifier_expr {
     token quantifier;
     std::vector<token> bound_vars;
-    std::shared_ptr<expr> body;
+    const expr* body;
 };
 
 struct unary_expr {
-    std::shared_ptr<expr> operand;
+    const expr* operand;
     token op;
 };
 
@@ -48,6 +58,12 @@ struct identifier {
     token name;
 };
 
+// and_all(...) or or_all(...), with op the & or | they apply
+struct nary_expr {
+    token op;
+    std::vector<const expr*> operands;
+};
+
 // Statements
 struct expr_stmt;
 struct func_call_stmt;
@@ -56,12 +72,12 @@ struct assign_stmt;
 using stmt = std::variant<expr_stmt, func_call_stmt, decl_stmt, assign_stmt>;
 
 struct expr_stmt {
-    std::shared_ptr<expr> expression;
+    const expr* expression;
 };
 
 struct func_call_stmt {
     token func_name;
-    std::vector<std::shared_ptr<expr>> arguments;
+    std::vector<const expr*> arguments;
 };
 
 struct decl_stmt {
@@ -69,14 +85,112 @@ struct decl_stmt {
 };
 
 struct assign_stmt {
-    std::shared_ptr<identifier> target;
-    std::shared_ptr<expr> value;
+    identifier target;
+    const expr* value;
 };
 
 std::string stmt_repr(const stmt& statement);
+std::string stmt_summary(const stmt& statement);  // one-line label, no exprs
 std::string expr_repr(const expr& expression);
-[[maybe_unused]] std::shared_ptr<expr> clone_expr(
-    const std::shared_ptr<expr>& expression);
 
 static_assert(std::is_move_constructible_v<stmt>, "stmt must be movable");
 static_assert(std::is_move_constructible_v<expr>, "expr must be movable");
+
+// Owns the expression nodes of a batch of statements. Nodes are bump
+// allocated in fixed size blocks and freed all at once by clear() or the
+// destructor, so pointers into the arena stay valid until then.
+//
+// Identifiers, literals and unary and binary expressions are hash-consed:
+// making a node equal to one already in the arena returns the existing node,
+// so structurally identical subexpressions are a single node and an
+// expression is a DAG. Substitutions, quantifiers, n-ary expressions and
+// strings are always new nodes.
+//
+// Only names are interned, so the arena keeps its own copy of the text of
+// number and string literals, which may be a view into the source.
+class Ast_Arena {
+    struct alignas(expr) Slot {
+        std::byte bytes[sizeof(expr)];
+    };
+    static constexpr size_t block_size = 256;  // nodes per block
+
+    // A consed node is identified by its operator or literal type, the
+    // symbol of its name and its (already consed) children
+    struct Cons_Key {
+        token::Type type;
+        symbol_id symbol;
+        const expr* left;
+        const expr* right;
+
+        bool operator==(const Cons_Key&) const = default;
+
+        template <typename H>
+        friend H AbslHashValue(H h, const Cons_Key& key) {
+            return H::combine(std::move(h), key.type, key.symbol, key.left,
+                              key.right);
+        }
+    };
+    static Cons_Key key_of(const bin_expr& node) {
+        return {node.op.type, 0, node.left, node.right};
+    }
+    static Cons_Key key_of(const unary_expr& node) {
+        return {node.op.type, 0, node.operand, nullptr};
+    }
+    static Cons_Key key_of(const literal& node) {  // true, false or a number
+        return {node.value.type, node.value.token_value.value_or(0), nullptr,
+                nullptr};
+    }
+    static Cons_Key key_of(const identifier& node) {
+        return {node.name.type, node.name.symbol, nullptr, nullptr};
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> blocks;
+    size_t used{block_size};  // nodes constructed in the last block
+    std::unordered_map<Cons_Key, const expr*, absl::Hash<Cons_Key>> consed;
+    std::deque<std::string> texts;  // of number and string literals
+
+    template <typename Node>
+    const expr* allocate(Node&& node) {
+        if (used == block_size) {
+            blocks.push_back(
+                std::make_unique_for_overwrite<Slot[]>(block_size));
+            used = 0;
+        }
+        const expr* ptr = std::construct_at(
+            reinterpret_cast<expr*>(blocks.back()[used].bytes),
+            std::forward<Node>(node));
+        ++used;
+        return ptr;
+    }
+
+   public:
+    Ast_Arena() = default;
+    Ast_Arena(const Ast_Arena&) = delete;
+    Ast_Arena& operator=(const Ast_Arena&) = delete;
+    Ast_Arena(Ast_Arena&& other) noexcept;
+    Ast_Arena& operator=(Ast_Arena&& other) noexcept;
+    ~Ast_Arena() { clear(); }
+
+    template <typename Node>
+    const expr* make(Node&& node) {
+        using T = std::remove_cvref_t<Node>;
+        if constexpr (std::is_same_v<T, sub_expr> ||
+                      std::is_same_v<T, quantifier_expr> ||
+                      std::is_same_v<T, nary_expr>) {
+            return allocate(std::forward<Node>(node));
+        } else {
+            const Cons_Key key = key_of(node);
+            if (const auto it = consed.find(key); it != consed.end()) {
+                return it->second;
+            }
+            return consed[key] = allocate(std::forward<Node>(node));
+        }
+    }
+
+    const expr* make(literal node);
+
+    size_t size() const {  // number of distinct nodes
+        return blocks.empty() ? 0 : (blocks.size() - 1) * block_size + used;
+    }
+    void clear();
+};
@@ -0,0 +1,113 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <fstream>
+#include <system_error>
+#include <thread>
+
+#include "absl/log/log.h"
+#include "engine_exceptions.h"
+
+namespace {
+// Runs one script in a fresh walker and writes its output file
+Batch_Result run_script(const std::filesystem::path& script,
+                        const Batch_Options& options) {
+    Batch_Result result{.script = script};
+    const auto start = std::chrono::steady_clock::now();
+    Walker walker;
+    walker.set_colours(false);  // output goes to a file
+    walker.set_source_all_or_nothing(options.source_all_or_nothing);
+    walker.set_statement_threads(options.statement_threads);
+    walker.set_nary_schedule(options.nary_schedule);
+    std::string output;
+    try {
+        if (options.snapshot.has_value()) {
+            walker.map_snapshot(options.snapshot->string());
+            walker.get_output();  // the mapping message is the same for all
+        }
+        if (std::ifstream f(script, std::ios::binary); !f.is_open()) {
+            output = "Failed to open file: " + script.string() + '\n';
+        } else {
+            result.completed = walker.run_source(f);
+            if (f.bad()) {
+                output = "Failed to read file: " + script.string() + '\n';
+                result.completed = false;
+            }
+        }
+    } catch (const ExecutionException& e) {
+        output = std::string(e.what()) + '\n';
+    }
+    output.insert(0, walker.get_output());
+    result.wall_time = std::chrono::steady_clock::now() - start;
+    result.peak_nodes = walker.get_peak_nodes();
+
+    const auto path =
+        options.output_dir / (script.filename().string() + ".out");
+    std::ofstream f(path, std::ios::binary);
+    f << output;
+    f.close();
+    if (f.fail()) {
+        LOG(ERROR) << "Failed to write file: " << path.string();
+        result.completed = false;
+    }
+    return result;
+}
+}  // namespace
+
+std::vector<Batch_Result> run_batch(const Batch_Options& options) {
+    std::error_code ec;
+    std::vector<std::filesystem::path> scripts;
+    for (const auto& entry :
+         std::filesystem::directory_iterator(options.dir, ec)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".bdd") {
+            scripts.push_back(entry.path());
+        }
+    }
+    if (ec) {
+        throw ExecutionException(
+            "Failed to read directory: " + options.dir.string(), __func__);
+    }
+    std::ranges::sort(scripts);
+    std::filesystem::create_directories(options.output_dir, ec);
+    if (ec) {
+        throw ExecutionException(
+            "Failed to create directory: " + options.output_dir.string(),
+            __func__);
+    }
+
+    // Walkers share nothing but the symbol table, so scripts need no
+    // coordination beyond handing each one to a single thread
+    std::vector<Batch_Result> results(scripts.size());
+    std::atomic<size_t> next{0};
+    const auto work = [&] {
+        for (size_t i; (i = next++) < scripts.size();) {
+            results[i] = run_script(scripts[i], options);
+        }
+    };
+    const size_t workers =
+        std::min(std::max<size_t>(options.jobs, 1), scripts.size());
+    std::vector<std::jthread> threads;
+    threads.reserve(workers);
+    for (size_t t = 0; t < workers; ++t) threads.emplace_back(work);
+    threads.clear();  // joins
+    return results;
+}
+
+void write_batch_summary(std::ostream& os,
+                         const std::span<const Batch_Result> results,
+                         const std::chrono::nanoseconds wall_time) {
+    const auto failed = std::ranges::count(results, false,
+                                           &Batch_Result::completed);
+    os << std::format("Batch: {} scripts, {} failed, {:.3f} ms\n",
+                      results.size(), failed, wall_time.count() / 1e6);
+    os << std::format("{:>12} {:>12} {:>9}  script\n", "time (ms)",
+                      "peak nodes", "status");
+    for (const auto& r : results) {
+        os << std::format("{:>12.3f} {:>12} {:>9}  {}\n",
+                          r.wall_time.count() / 1e6, r.peak_nodes,
+                          r.completed ? "ok" : "failed",
+                          r.script.filename().string());
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+// Batch mode: runs every script in a directory in its own Walker, several at
+// a time, so that many small scripts share one process
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "walker.h"
+
+struct Batch_Options {
+    std::filesystem::path dir;         // scripts are the *.bdd files in it
+    std::filesystem::path output_dir;  // gets <script name>.out per script
+    size_t jobs{1};                    // scripts run at once
+    std::optional<std::filesystem::path> snapshot;  // mapped by every walker
+    // Settings of every walker (see the Walker setters)
+    bool source_all_or_nothing{};
+    size_t statement_threads{1};
+    Nary_Schedule nary_schedule{Nary_Schedule::IN_ORDER};
+};
+
+struct Batch_Result {
+    std::filesystem::path script;
+    std::chrono::nanoseconds wall_time{};
+    size_t peak_nodes{};
+    bool completed{};  // ran to the end without an error
+};
+
+// Runs the scripts in name order and returns their results in that order.
+// Throws ExecutionException if the directories cannot be used.
+std::vector<Batch_Result> run_batch(const Batch_Options& options);
+
+void write_batch_summary(std::ostream& os,
+                         std::span<const Batch_Result> results,
+                         std::chrono::nanoseconds wall_time);
@@ -0,0 +1,103 @@
+#include "bdd.h"
+
+#include <format>
+#include <string>
+#include <vector>
+
+#include "engine_exceptions.h"
+#include "walker.h"
+
+Manager::Manager() : walker(std::make_unique<Walker>()) {}
+
+Manager::~Manager() = default;
+
+Bdd Manager::constant(const bool value) { return {this, value ? 1u : 0u}; }
+
+Bdd Manager::var(const uint32_t level) {
+    // A name already in use, say v5 declared by name at level 2, is skipped
+    // rather than redeclared, so every pass adds a level or moves past one
+    for (auto next = static_cast<uint32_t>(walker->bdd_ordering.size());
+         walker->bdd_ordering.size() <= level; ++next) {
+        const std::string name = std::format("v{}", next);
+        if (walker->find_global(intern(name).id) == nullptr) {
+            walker->declare_var(name);
+        }
+    }
+    return {this, walker->get_id(Bdd_Node{Bdd_Node::Bdd_type::INTERNAL, level,
+                                          1, 0})};
+}
+
+Bdd Manager::var(const std::string_view name) {
+    const uint32_t level = walker->declare_var(name);
+    return {this, walker->get_id(Bdd_Node{Bdd_Node::Bdd_type::INTERNAL, level,
+                                          1, 0})};
+}
+
+uint32_t Manager::num_vars() const {
+    return static_cast<uint32_t>(walker->bdd_ordering.size());
+}
+
+size_t Manager::live_nodes() const { return walker->get_live_nodes(); }
+
+Walker& Bdd::walker_for(const Bdd& other) const {
+    if (manager != other.manager) {
+        throw ExecutionException("BDDs belong to different managers",
+                                 "Bdd::walker_for");
+    }
+    return *manager->walker;
+}
+
+uint32_t Bdd::level() const {
+    if (node > 1) {
+        const Bdd_Node& n = manager->walker->node_of(node);
+        if (n.high == 1 && n.low == 0) return n.var;
+    }
+    throw ExecutionException(std::format("BDD {} is not a variable", node),
+                             __func__);
+}
+
+Bdd Bdd::operator!() const {
+    return {manager, manager->walker->rec_apply_not(node)};
+}
+
+Bdd Bdd::operator&(const Bdd& other) const {
+    return {manager, walker_for(other).rec_apply_and(node, other.node)};
+}
+
+Bdd Bdd::operator|(const Bdd& other) const {
+    return {manager, walker_for(other).rec_apply_or(node, other.node)};
+}
+
+Bdd Bdd::operator^(const Bdd& other) const {
+    Walker& w = walker_for(other);
+    const uint32_t both = w.rec_apply_and(node, other.node);
+    return {manager, w.rec_apply_and(w.rec_apply_or(node, other.node),
+                                     w.rec_apply_not(both))};
+}
+
+std::vector<uint32_t> Bdd::levels_of(const std::span<const Bdd> vars) const {
+    std::vector<uint32_t> levels;
+    levels.reserve(vars.size());
+    for (const Bdd& var : vars) {
+        walker_for(var);
+        levels.push_back(var.level());
+    }
+    return levels;
+}
+
+Bdd Bdd::exists(const std::span<const Bdd> vars) const {
+    return {manager, manager->walker->quantify(node, levels_of(vars), true)};
+}
+
+Bdd Bdd::forall(const std::span<const Bdd> vars) const {
+    return {manager, manager->walker->quantify(node, levels_of(vars), false)};
+}
+
+Bdd Bdd::compose(const Bdd& var, const Bdd& g) const {
+    walker_for(var);
+    return {manager, walker_for(g).compose(node, var.level(), g.node)};
+}
+
+double Bdd::sat_count() const { return manager->walker->sat_count(node); }
+
+size_t Bdd::size() const { return manager->walker->bdd_size(node); }
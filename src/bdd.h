@@ -0,0 +1,89 @@
+#pragma once
+// Library API for embedding the engine in C++ tools
+//
+// A Manager owns a node store and hands out Bdd handles to its nodes, so BDDs
+// are built and combined by function calls rather than by formatting script
+// statements and parsing their output. A handle is a manager and a node id:
+// copying one is free, and two handles of one manager are equal exactly when
+// their functions are. Nodes live as long as their manager, which never
+// sweeps them.
+//
+// Operations throw ExecutionException when given handles of different
+// managers, or a non-variable where a variable is expected.
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+class Walker;
+class Bdd;
+
+class Manager {
+    std::unique_ptr<Walker> walker;
+    friend class Bdd;
+
+   public:
+    Manager();
+    ~Manager();
+    // Handles point to their manager, so it stays where it is
+    Manager(const Manager&) = delete;
+    Manager& operator=(const Manager&) = delete;
+
+    Bdd constant(bool value);
+    // The variable at position level in the ordering, declaring v0 to
+    // v{level} as needed, as load_cnf does. Names that are already taken
+    // are skipped, so the new levels may be called v{level + 1} and up.
+    Bdd var(uint32_t level);
+    // The variable called name, declared last in the ordering if new
+    Bdd var(std::string_view name);
+
+    uint32_t num_vars() const;
+    size_t live_nodes() const;
+};
+
+class Bdd {
+    Manager* manager;
+    uint32_t node;
+
+    Bdd(Manager* manager, const uint32_t node)
+        : manager(manager), node(node) {}
+    friend class Manager;
+
+    Walker& walker_for(const Bdd& other) const;  // checks the managers match
+    uint32_t level() const;  // of a variable, else throws
+    std::vector<uint32_t> levels_of(std::span<const Bdd> vars) const;
+
+   public:
+    uint32_t id() const { return node; }
+    bool is_true() const { return node == 1; }
+    bool is_false() const { return node == 0; }
+    bool operator==(const Bdd&) const = default;
+
+    Bdd operator!() const;
+    Bdd operator&(const Bdd& other) const;
+    Bdd operator|(const Bdd& other) const;
+    Bdd operator^(const Bdd& other) const;
+    Bdd& operator&=(const Bdd& other) { return *this = *this & other; }
+    Bdd& operator|=(const Bdd& other) { return *this = *this | other; }
+    Bdd& operator^=(const Bdd& other) { return *this = *this ^ other; }
+
+    // Quantify the given variables out
+    Bdd exists(std::span<const Bdd> vars) const;
+    Bdd exists(std::initializer_list<Bdd> vars) const {
+        return exists(std::span(vars.begin(), vars.size()));
+    }
+    Bdd forall(std::span<const Bdd> vars) const;
+    Bdd forall(std::initializer_list<Bdd> vars) const {
+        return forall(std::span(vars.begin(), vars.size()));
+    }
+
+    // This function with var replaced by g
+    Bdd compose(const Bdd& var, const Bdd& g) const;
+
+    // Satisfying assignments over all of the manager's variables
+    double sat_count() const;
+    size_t size() const;  // nodes, including the terminals reached
+};
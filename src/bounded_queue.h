@@ -0,0 +1,53 @@
+#pragma once
+// Blocking FIFO queue of bounded capacity between threads
+//
+// push blocks while the queue is full, which caps how far a producer can run
+// ahead of its consumer. Once closed, push fails at once and pop returns the
+// items still queued and then nullopt, so either side can stop the other.
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+template <typename T>
+class Bounded_Queue {
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+    std::deque<T> items;
+    const size_t capacity;
+    bool closed{};
+
+   public:
+    explicit Bounded_Queue(const size_t capacity) : capacity(capacity) {}
+
+    // Returns false, dropping item, if the queue has been closed
+    bool push(T item) {
+        std::unique_lock lock(mutex);
+        not_full.wait(lock, [&] { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    // Returns nullopt once the queue is closed and empty
+    std::optional<T> pop() {
+        std::unique_lock lock(mutex);
+        not_empty.wait(lock, [&] { return closed || !items.empty(); });
+        if (items.empty()) return std::nullopt;
+        T item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return item;
+    }
+
+    void close() {
+        const std::lock_guard lock(mutex);
+        closed = true;
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+};
@@ -0,0 +1,63 @@
+#pragma once
+// Straight-line programs that evaluate an expression (see
+// walker_bytecode.cpp)
+//
+// An expression DAG is lowered into instructions in evaluation order, one per
+// distinct node, so evaluating it is a single loop over a flat array instead
+// of a recursive visit of the tree. Instruction i writes register i and its
+// operands are registers of earlier instructions. Names are resolved while
+// lowering: a symbolic variable becomes its level and a bound name the id of
+// its BDD, so the loop does no lookups.
+//
+// Lowering also simplifies: chains of & and | become single n-ary
+// instructions, and constants, repeated operands, double negations and
+// similar patterns are folded away before anything is applied.
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ast.h"
+
+struct Bc_Instr {
+    enum class Op : std::uint8_t {
+        CONST,       // a: node id
+        VAR,         // a: level of a symbolic variable
+        NOT,         // a: register
+        AND,         // operands [a, a + b) of the program, at least two
+        OR,          // as AND
+        EXISTS,      // a: register, levels [b, b + c) of the program
+        FORALL,      // as EXISTS
+        SUBSTITUTE,  // a: index of a sub_expr in substitutions
+        ID,          // a: node id, checked when reached, b: index in errors
+        FAIL,        // a: index of an error message in errors
+    };
+
+    Op op;
+    uint32_t a{};
+    uint32_t b{};
+    uint32_t c{};
+};
+
+struct Bytecode {
+    std::vector<Bc_Instr> code;
+    uint32_t result{};               // register holding the expression's BDD
+    std::vector<uint32_t> operands;  // registers of AND and OR
+    std::vector<uint32_t> levels;    // bound by quantifiers
+    std::vector<const sub_expr*> substitutions;
+    // A name or literal that cannot be evaluated fails when its instruction
+    // is reached, even if simplification made its value unnecessary. Node
+    // ids are checked then too, as the program may create the node.
+    std::vector<std::string> errors;
+    // The register evaluating each expression node, remembered afterwards
+    std::vector<std::pair<const expr*, uint32_t>> nodes;
+
+    void clear() {  // keeps the capacity for the next program
+        code.clear();
+        operands.clear();
+        levels.clear();
+        substitutions.clear();
+        errors.clear();
+        nodes.clear();
+    }
+};
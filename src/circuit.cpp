@@ -0,0 +1,396 @@
+#include "circuit.h"
+
+#include <array>
+#include <cctype>
+#include <format>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+
+#include "absl/hash/hash.h"
+#include "engine_exceptions.h"
+
+namespace {
+constexpr uint32_t unset = std::numeric_limits<uint32_t>::max();
+
+// Builds an Aig, merging structurally identical gates and folding constants
+class Aig_Builder {
+    Aig aig;
+    std::unordered_map<std::pair<uint32_t, uint32_t>, uint32_t,
+                       absl::Hash<std::pair<uint32_t, uint32_t>>>
+        strash;
+
+   public:
+    // Every input must be added before the first gate
+    uint32_t input(std::string name) {
+        aig.inputs.push_back(std::move(name));
+        return 2 * static_cast<uint32_t>(aig.inputs.size());
+    }
+
+    uint32_t and_of(uint32_t a, uint32_t b) {
+        if (a > b) std::swap(a, b);
+        if (a == 0 || (a ^ 1) == b) return 0;
+        if (a == 1) return b;
+        if (a == b) return a;
+        if (const auto it = strash.find({a, b}); it != strash.end()) {
+            return it->second;
+        }
+        aig.gates.emplace_back(a, b);
+        const auto var =
+            static_cast<uint32_t>(aig.inputs.size() + aig.gates.size());
+        return strash[{a, b}] = 2 * var;
+    }
+
+    uint32_t or_of(const uint32_t a, const uint32_t b) {
+        return and_of(a ^ 1, b ^ 1) ^ 1;
+    }
+
+    void output(std::string name, const uint32_t lit) {
+        aig.outputs.emplace_back(std::move(name), lit);
+    }
+
+    Aig finish() { return std::move(aig); }
+};
+
+// Visits the definitions reachable from root in post-order, without
+// recursion so that deep circuits cannot overflow the stack. state holds
+// 0 (unvisited), 1 (on the current path) or 2 (done) for every signal.
+template <typename Fanins, typename Visit>
+void visit_post_order(const uint32_t root, std::vector<uint8_t>& state,
+                      Fanins fanins, Visit visit) {
+    std::vector<uint32_t> stack{root};
+    while (!stack.empty()) {
+        const uint32_t signal = stack.back();
+        if (state[signal] == 2) {
+            stack.pop_back();
+        } else if (state[signal] == 1) {
+            visit(signal);
+            state[signal] = 2;
+            stack.pop_back();
+        } else {
+            state[signal] = 1;
+            for (const uint32_t fanin : fanins(signal)) {
+                if (state[fanin] == 1) {
+                    throw ExecutionException("Combinational cycle in circuit",
+                                             "visit_post_order");
+                }
+                if (state[fanin] == 0) stack.push_back(fanin);
+            }
+        }
+    }
+}
+
+// Names become identifiers: invalid characters are replaced by '_', and a
+// name that does not start with a letter gains an 'n' in front
+std::string identifier_for(const std::string& name) {
+    std::string result;
+    if (name.empty() || !isalpha(static_cast<unsigned char>(name[0]))) {
+        result += 'n';
+    }
+    for (const char c : name) {
+        result += isalnum(static_cast<unsigned char>(c)) || c == '_' ? c : '_';
+    }
+    return result;
+}
+
+[[noreturn]] void malformed(const std::string& what) {
+    throw ExecutionException("Malformed AIGER file: " + what, "read_aiger");
+}
+
+uint32_t read_number(std::istream& is, const char* what) {
+    int64_t value = -1;
+    if (!(is >> value) || value < 0 || value > unset / 2) malformed(what);
+    return static_cast<uint32_t>(value);
+}
+
+// Binary AIGER stores gates as deltas in 7-bit groups, low bits first
+uint32_t read_delta(std::istream& is) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        const int c = is.get();
+        if (c == EOF) malformed("truncated gates");
+        // The fifth group only has room for the top 4 of 32 bits
+        if (shift == 28 && (c & 0x70) != 0) malformed("gate delta too large");
+        value |= static_cast<uint32_t>(c & 0x7f) << shift;
+        if ((c & 0x80) == 0) return value;
+    }
+    malformed("gate delta too large");
+}
+}  // namespace
+
+Aig read_aiger(std::istream& is) {
+    std::string header;
+    std::getline(is, header);
+    std::istringstream fields(header);
+    std::string format;
+    fields >> format;
+    if (format != "aag" && format != "aig") {
+        throw ExecutionException("Not an AIGER file", __func__);
+    }
+    const bool binary = format == "aig";
+    const uint32_t max_var = read_number(fields, "header");
+    const uint32_t num_inputs = read_number(fields, "header");
+    const uint32_t num_latches = read_number(fields, "header");
+    const uint32_t num_outputs = read_number(fields, "header");
+    const uint32_t num_gates = read_number(fields, "header");
+    // AIGER 1.9 adds bad, constraint, justice and fairness sections
+    bool sequential = num_latches != 0;
+    for (int64_t extra = 0; fields >> extra;) sequential |= extra != 0;
+    if (sequential) {
+        throw ExecutionException("Sequential circuits are not supported",
+                                 __func__);
+    }
+    if (static_cast<uint64_t>(num_inputs) + num_gates > max_var) {
+        malformed("header");
+    }
+
+    // Vars are numbered densely in the order they are first seen, so that
+    // memory follows what the file contains rather than the max_var it
+    // claims. The definition of every var: an input index or a gate's fanins.
+    std::unordered_map<uint32_t, uint32_t> index_of{{0, 0}};
+    std::vector<uint32_t> var_of{0};  // by index
+    std::vector<uint32_t> input_of{unset};
+    std::vector<std::pair<uint32_t, uint32_t>> gate_of{{unset, unset}};
+    // Returns the literal with its var replaced by the var's index
+    const auto check_lit = [&](const uint32_t lit) {
+        if (lit / 2 > max_var) malformed(std::format("literal {}", lit));
+        const auto [it, inserted] =
+            index_of.try_emplace(lit / 2, static_cast<uint32_t>(var_of.size()));
+        if (inserted) {
+            var_of.push_back(lit / 2);
+            input_of.push_back(unset);
+            gate_of.emplace_back(unset, unset);
+        }
+        return 2 * it->second | (lit & 1);
+    };
+    std::vector<uint32_t> input_vars;
+    for (uint32_t i = 0; i < num_inputs; ++i) {
+        const uint32_t lit = binary ? 2 * (i + 1) : read_number(is, "input");
+        if (lit < 2 || lit % 2 != 0) malformed(std::format("input {}", lit));
+        const uint32_t var = check_lit(lit) / 2;
+        if (input_of[var] != unset) malformed(std::format("input {}", lit));
+        input_of[var] = i;
+        input_vars.push_back(var);
+    }
+    std::vector<uint32_t> output_lits;
+    for (uint32_t i = 0; i < num_outputs; ++i) {
+        output_lits.push_back(check_lit(read_number(is, "output")));
+    }
+    // The binary gate section starts right after the last output's line
+    if (binary && num_outputs > 0) {
+        is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    for (uint32_t i = 0; i < num_gates; ++i) {
+        uint32_t lhs = 0;
+        uint32_t rhs0 = 0;
+        uint32_t rhs1 = 0;
+        if (binary) {
+            lhs = 2 * (num_inputs + i + 1);
+            const uint32_t delta0 = read_delta(is);
+            const uint32_t delta1 = read_delta(is);
+            if (delta0 > lhs || delta1 > lhs - delta0) malformed("gate delta");
+            rhs0 = lhs - delta0;
+            rhs1 = rhs0 - delta1;
+        } else {
+            lhs = read_number(is, "gate");
+            rhs0 = read_number(is, "gate");
+            rhs1 = read_number(is, "gate");
+        }
+        if (lhs < 2 || lhs % 2 != 0) malformed(std::format("gate {}", lhs));
+        const uint32_t var = check_lit(lhs) / 2;
+        if (input_of[var] != unset || gate_of[var].first != unset) {
+            malformed(std::format("gate {}", lhs));
+        }
+        gate_of[var] = {check_lit(rhs0), check_lit(rhs1)};
+    }
+
+    // Optional symbol table, ended by a comment section
+    std::vector<std::string> input_names(num_inputs);
+    std::vector<std::string> output_names(num_outputs);
+    for (std::string line; std::getline(is, line) && !line.starts_with('c');) {
+        const auto space = line.find(' ');
+        if (line.empty() || space == std::string::npos) continue;
+        uint32_t index = 0;
+        std::istringstream(line.substr(1, space - 1)) >> index;
+        const std::string name = line.substr(space + 1);
+        if (line[0] == 'i' && index < num_inputs) input_names[index] = name;
+        if (line[0] == 'o' && index < num_outputs) output_names[index] = name;
+    }
+
+    Aig_Builder builder;
+    std::vector<uint32_t> mapped(var_of.size(), unset);
+    mapped[0] = 0;
+    for (uint32_t i = 0; i < num_inputs; ++i) {
+        mapped[input_vars[i]] = builder.input(
+            input_names[i].empty() ? std::format("i{}", i)
+                                   : identifier_for(input_names[i]));
+    }
+    const auto map_lit = [&](const uint32_t lit) {
+        return mapped[lit / 2] ^ (lit & 1);
+    };
+
+    std::vector<uint8_t> state(var_of.size());
+    for (uint32_t var = 0; var < var_of.size(); ++var) {
+        if (mapped[var] != unset) state[var] = 2;
+    }
+    const auto fanins = [&](const uint32_t var) {
+        const auto [rhs0, rhs1] = gate_of[var];
+        if (rhs0 == unset) {
+            malformed(std::format("undefined var {}", var_of[var]));
+        }
+        return std::array{rhs0 / 2, rhs1 / 2};
+    };
+    const auto build = [&](const uint32_t var) {
+        mapped[var] = builder.and_of(map_lit(gate_of[var].first),
+                                     map_lit(gate_of[var].second));
+    };
+    for (uint32_t i = 0; i < num_outputs; ++i) {
+        visit_post_order(output_lits[i] / 2, state, fanins, build);
+        builder.output(output_names[i].empty()
+                           ? std::format("o{}", i)
+                           : identifier_for(output_names[i]),
+                       map_lit(output_lits[i]));
+    }
+    return builder.finish();
+}
+
+Aig read_blif(std::istream& is) {
+    const auto fail = [](const size_t line_no, const std::string& what) {
+        throw ExecutionException(std::format("BLIF line {}: {}", line_no, what),
+                                 "read_blif");
+    };
+
+    // A .names block: a cover of cubes over the fanins, describing the
+    // on-set if onset is true and the off-set otherwise
+    struct Blif_Node {
+        std::vector<uint32_t> fanins;
+        std::vector<std::string> cubes;
+        bool onset = true;
+        bool defined = false;
+    };
+    std::unordered_map<std::string, uint32_t> signal_of;
+    std::vector<std::string> names;
+    std::vector<Blif_Node> nodes;
+    const auto signal = [&](const std::string& name) {
+        const auto [it, inserted] = signal_of.try_emplace(name, names.size());
+        if (inserted) {
+            names.push_back(name);
+            nodes.emplace_back();
+        }
+        return it->second;
+    };
+
+    std::vector<uint32_t> inputs;
+    std::vector<uint32_t> outputs;
+    Blif_Node* current = nullptr;
+    size_t line_no = 0;
+    for (std::string line; std::getline(is, line);) {
+        ++line_no;
+        // Continuation lines end with a backslash
+        while (line.ends_with('\\')) {
+            line.pop_back();
+            std::string next;
+            if (!std::getline(is, next)) break;
+            ++line_no;
+            line += ' ' + next;
+        }
+        if (const auto hash = line.find('#'); hash != std::string::npos) {
+            line.erase(hash);
+        }
+        std::istringstream words(line);
+        std::vector<std::string> tokens;
+        for (std::string word; words >> word;) tokens.push_back(word);
+        if (tokens.empty()) continue;
+
+        const std::string& directive = tokens[0];
+        if (!directive.starts_with('.')) {
+            // A row of the current cover
+            if (current == nullptr) fail(line_no, "cube outside of .names");
+            const std::string cube = current->fanins.empty() ? "" : tokens[0];
+            const size_t bit = current->fanins.empty() ? 0 : 1;
+            if (tokens.size() != bit + 1 ||
+                cube.size() != current->fanins.size() ||
+                cube.find_first_not_of("01-") != std::string::npos ||
+                (tokens[bit] != "0" && tokens[bit] != "1")) {
+                fail(line_no, "malformed cube");
+            }
+            const bool onset = tokens[bit] == "1";
+            if (!current->cubes.empty() && onset != current->onset) {
+                fail(line_no, "cover mixes on-set and off-set rows");
+            }
+            current->onset = onset;
+            current->cubes.push_back(cube);
+            continue;
+        }
+
+        current = nullptr;
+        if (directive == ".model") continue;
+        if (directive == ".end") break;
+        if (directive == ".inputs" || directive == ".outputs") {
+            auto& list = directive == ".inputs" ? inputs : outputs;
+            for (size_t i = 1; i < tokens.size(); ++i) {
+                list.push_back(signal(tokens[i]));
+            }
+            if (directive == ".inputs") {
+                for (size_t i = 1; i < tokens.size(); ++i) {
+                    nodes[signal(tokens[i])].defined = true;
+                }
+            }
+        } else if (directive == ".names") {
+            if (tokens.size() < 2) fail(line_no, ".names without an output");
+            const uint32_t out = signal(tokens.back());
+            if (nodes[out].defined) {
+                fail(line_no, "signal defined twice: " + tokens.back());
+            }
+            std::vector<uint32_t> fanins;
+            for (size_t i = 1; i + 1 < tokens.size(); ++i) {
+                fanins.push_back(signal(tokens[i]));
+            }
+            current = &nodes[out];
+            current->fanins = std::move(fanins);
+            current->defined = true;
+        } else if (directive == ".latch") {
+            throw ExecutionException("Sequential circuits are not supported",
+                                     __func__);
+        } else {
+            fail(line_no, "unsupported construct " + directive);
+        }
+    }
+
+    Aig_Builder builder;
+    std::vector<uint32_t> mapped(names.size(), unset);
+    std::vector<uint8_t> state(names.size());
+    for (const uint32_t input : inputs) {
+        if (mapped[input] != unset) continue;
+        mapped[input] = builder.input(identifier_for(names[input]));
+        state[input] = 2;
+    }
+
+    const auto fanins = [&](const uint32_t s) -> const std::vector<uint32_t>& {
+        if (!nodes[s].defined) {
+            throw ExecutionException("Undefined signal in BLIF: " + names[s],
+                                     "read_blif");
+        }
+        return nodes[s].fanins;
+    };
+    const auto build = [&](const uint32_t s) {
+        // A cover without rows is constant false
+        const Blif_Node& node = nodes[s];
+        uint32_t cover = 0;
+        for (const std::string& cube : node.cubes) {
+            uint32_t product = 1;
+            for (size_t i = 0; i < cube.size(); ++i) {
+                if (cube[i] == '-') continue;
+                product = builder.and_of(
+                    product, mapped[node.fanins[i]] ^ (cube[i] == '0'));
+            }
+            cover = builder.or_of(cover, product);
+        }
+        mapped[s] = node.onset ? cover : cover ^ 1;
+    };
+    for (const uint32_t output : outputs) {
+        visit_post_order(output, state, fanins, build);
+        builder.output(identifier_for(names[output]), mapped[output]);
+    }
+    return builder.finish();
+}
@@ -0,0 +1,25 @@
+#pragma once
+// Combinational circuits read from AIGER and BLIF netlists
+//
+// Both formats become a structurally hashed and-inverter graph. Literals follow
+// the AIGER convention, 2 * var + 1 if complemented, with var 0 the constant
+// false. Inputs are vars 1..inputs.size() and gate g is var inputs.size() + 1
+// + g. A gate only refers to inputs and earlier gates, so gates are in
+// topological order, and only gates reachable from an output are kept.
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct Aig {
+    std::vector<std::string> inputs;
+    std::vector<std::pair<uint32_t, uint32_t>> gates;  // fanin literals
+    std::vector<std::pair<std::string, uint32_t>> outputs;
+};
+
+// Both throw ExecutionException on malformed or sequential netlists. Names are
+// made into valid identifiers; unnamed AIGER inputs and outputs are called
+// i{k} and o{k}.
+Aig read_aiger(std::istream& is);  // ASCII ("aag") or binary ("aig")
+Aig read_blif(std::istream& is);
@@ -1,10 +1,23 @@
 #pragma once
 #include <absl/base/log_severity.h>
 
-constexpr bool echo_input = false;    // Set to true to echo input
-constexpr bool print_tokens = false;  // Set to true to print tokens
-constexpr bool print_ast = false;     // Set to true to print AST
+#include <cstddef>
+
+constexpr bool echo_input = false;      // Set to true to echo input
+constexpr bool print_tokens = false;    // Set to true to print tokens
+constexpr bool print_ast = false;       // Set to true to print AST
+constexpr bool enable_tracing = false;  // Set to true to allow --trace output
 constexpr auto warning_level = absl::LogSeverity::kWarning;
 
 // Set to true to enable coloured parser errors
-constexpr bool use_colours = true;
\ No newline at end of file
+constexpr bool use_colours = true;
+
+// Number of statements listed by profile_report when no count is given
+constexpr std::size_t default_profile_top_n = 20;
+// Parse sourced scripts on a background thread while earlier statements run.
+// WebAssembly builds have no threads.
+#ifdef __EMSCRIPTEN__
+constexpr bool use_parse_thread = false;
+#else
+constexpr bool use_parse_thread = true;
+#endif
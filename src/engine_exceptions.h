@@ -31,7 +31,7 @@ class LexerException final : public std::exception {
 // Parser Exception Type
 class ParserException final : public std::exception {
     std::string message;
-    token next_token;
+    std::string next_lexeme;  // a copy, as the source may be gone by then
     std::string function_name;
     std::source_location location;
 
@@ -43,14 +43,14 @@ class ParserException final : public std::exception {
         const std::string_view fn_name,
         const std::source_location& loc = std::source_location::current())
         : message(msg),
-          next_token(nxt_token),
+          next_lexeme(nxt_token.lexeme),
           function_name(fn_name),
           location(loc) {}
 
     const char* what() const noexcept override {
         formatted_message = std::format(
             "ParserException: [{}:{}] {} but next token is {}", function_name,
-            location.line(), message, next_token.lexeme);
+            location.line(), message, next_lexeme);
 
         return formatted_message.c_str();
     }
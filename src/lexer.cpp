@@ -2,33 +2,57 @@
 
 #include <unordered_map>
 
-const std::unordered_map<std::string, token::Type> keyword_map = {
+// Keyed by views of the literals, so keyword tokens need no storage of their
+// own
+const std::unordered_map<std::string_view, token::Type> keyword_map = {
     {"bvar", token::Type::BVAR},
     {"set", token::Type::SET},
     {"true", token::Type::TRUE},
     {"false", token::Type::FALSE},
     {"display_tree", token::Type::TREE_DISPLAY},
     {"display_graph", token::Type::GRAPH_DISPLAY},
+    {"display_dag", token::Type::DAG_DISPLAY},
     {"is_sat", token::Type::IS_SAT},
     {"source", token::Type::SOURCE},
     {"sub", token::Type::SUBSTITUTE},
     {"exists", token::Type::EXISTS},
     {"forall", token::Type::FORALL},
+    {"and_all", token::Type::AND_ALL},
+    {"or_all", token::Type::OR_ALL},
     {"clear_cache", token::Type::CLEAR_CACHE},
     {"preserve", token::Type::PRESERVE},
     {"preserve_all", token::Type::PRESERVE_ALL},
     {"unpreserve", token::Type::UNPRESERVE},
     {"unpreserve_all", token::Type::UNPRESERVE_ALL},
     {"sweep", token::Type::SWEEP},
+    {"profile_on", token::Type::PROFILE_ON},
+    {"profile_off", token::Type::PROFILE_OFF},
+    {"profile_report", token::Type::PROFILE_REPORT},
+    {"profile_csv", token::Type::PROFILE_CSV},
+    {"save", token::Type::SAVE},
+    {"load", token::Type::LOAD},
+    {"load_cnf", token::Type::LOAD_CNF},
+    {"load_aiger", token::Type::LOAD_AIGER},
+    {"load_blif", token::Type::LOAD_BLIF},
+    {"as", token::Type::AS},
+    {"to", token::Type::TO},
+    {"limit", token::Type::LIMIT},
 };
 
 constexpr bool is_lexeme_char(const char c) {
     return isalpha(c) || isdigit(c) || c == '_' || c == '.';
 }
 
-lex_result_t scan_to_tokens(const std::string& source) {
+lex_result_t scan_to_tokens(const std::string_view source) {
+    // Names and numbers are sliced out of source rather than copied; the token
+    // constructor interns them, which only copies a name the first time
     std::vector<token> tokens;
     size_t i = 0;
+    const auto scan_while = [&](auto predicate) {
+        const size_t start = i;
+        while (i < source.size() && predicate(source[i])) ++i;
+        return source.substr(start, i - start);
+    };
 
     while (i < source.size()) {
         switch (char c = source[i]) {
@@ -84,6 +108,17 @@ lex_result_t scan_to_tokens(const std::string& source) {
                     tokens.emplace_back(token::Type::MINUS, "-");
                 }
                 break;
+            case '"': {
+                const size_t end = source.find_first_of("\"\n", i + 1);
+                if (end == std::string_view::npos || source[end] != '"') {
+                    return std::unexpected(
+                        LexerException("Unterminated string", __func__));
+                }
+                tokens.emplace_back(token::Type::STRING,
+                                    source.substr(i + 1, end - i - 1));
+                i = end;  // Skip to the closing '"'
+                break;
+            }
             case '\n':
             case '\r':
             case '\t':
@@ -92,26 +127,21 @@ lex_result_t scan_to_tokens(const std::string& source) {
                 break;
             default:
                 if (isalpha(c)) {
-                    std::string identifier;
-                    while (is_lexeme_char(c)) {
-                        identifier += c;
-                        c = source[++i];
-                    }
-                    if (keyword_map.contains(identifier)) {
-                        tokens.emplace_back(keyword_map.at(identifier),
-                                            identifier);
+                    const std::string_view name = scan_while(is_lexeme_char);
+                    if (const auto it = keyword_map.find(name);
+                        it != keyword_map.end()) {
+                        tokens.emplace_back(it->second, it->first);
                     } else {
-                        tokens.emplace_back(token::Type::IDENTIFIER,
-                                            std::move(identifier));
+                        tokens.emplace_back(token::Type::IDENTIFIER, name);
                     }
                 } else if (isdigit(c)) {
+                    const std::string_view digits =
+                        scan_while([](const char d) { return isdigit(d); });
                     uint32_t number = 0;
-                    while (isdigit(c)) {
-                        number = number * 10 + (c - '0');
-                        c = source[++i];
+                    for (const char d : digits) {
+                        number = number * 10 + (d - '0');
                     }
-                    tokens.emplace_back(token::Type::ID, std::to_string(number),
-                                        number);
+                    tokens.emplace_back(token::Type::ID, digits, number);
                 } else {
                     return std::unexpected(LexerException(
                         "Unexpected character: " + std::string(1, c),
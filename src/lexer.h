@@ -2,8 +2,9 @@
 
 #include <expected>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "engine_exceptions.h"
 
 using lex_result_t = std::expected<std::vector<token>, LexerException>;
-lex_result_t scan_to_tokens(const std::string& source);
\ No newline at end of file
+lex_result_t scan_to_tokens(std::string_view source);
\ No newline at end of file
@@ -1,18 +1,105 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <fstream>
 #include <iostream>
 #include <optional>
 #include <string>
+#include <thread>
+
+#include <unistd.h>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/flags/usage.h"
 #include "absl/log/globals.h"
 #include "absl/log/initialize.h"
+#include "absl/log/log.h"
+#include "batch.h"
+#include "engine_exceptions.h"
 #include "repl.h"
+#include "server.h"
+#include "trace.h"
 #include "walker.h"
 
 #include "config.h"
 
 ABSL_FLAG(std::optional<std::string>, source, std::nullopt, "Input script to execute.");
+ABSL_FLAG(bool, profile, false, "Record per-statement timings and BDD growth.");
+ABSL_FLAG(size_t, profile_top, default_profile_top_n,
+          "Number of statements in the profile report.");
+ABSL_FLAG(std::optional<std::string>, profile_csv, std::nullopt,
+          "Write the full profile as CSV to this file instead of a report.");
+ABSL_FLAG(std::optional<std::string>, trace, std::nullopt,
+          "Write a Chrome trace (JSON) of engine operations to this file.");
+ABSL_FLAG(std::optional<std::string>, snapshot, std::nullopt,
+          "Start from this snapshot, mapped read-only instead of loaded.");
+ABSL_FLAG(bool, source_all_or_nothing, false,
+          "Parse a whole sourced script before running it, so that a parse "
+          "error anywhere runs none of it.");
+ABSL_FLAG(size_t, statement_threads, 1,
+          "Run independent assignments on up to this many threads.");
+ABSL_FLAG(std::string, nary_schedule, "in_order",
+          "Order in which and_all, or_all and chains of & or | combine their "
+          "operands: in_order, smallest or balanced.");
+ABSL_FLAG(std::optional<std::string>, batch, std::nullopt,
+          "Run every .bdd script in this directory, each in its own session.");
+ABSL_FLAG(size_t, jobs, 0,
+          "Scripts run at once in batch mode (0 for one per hardware thread).");
+ABSL_FLAG(std::optional<std::string>, batch_output, std::nullopt,
+          "Directory for the .out file of each batch script (default: the "
+          "batch directory).");
+ABSL_FLAG(std::optional<std::string>, serve, std::nullopt,
+          "Serve scripts sent to a Unix domain socket at this path.");
+
+// Runs --batch and prints its summary; fails if any script did
+static int run_batch_mode(const std::string& dir,
+                          const Nary_Schedule schedule) {
+    Batch_Options options{
+        .dir = dir,
+        .output_dir = absl::GetFlag(FLAGS_batch_output).value_or(dir),
+        .jobs = absl::GetFlag(FLAGS_jobs),
+        .snapshot = absl::GetFlag(FLAGS_snapshot),
+        .source_all_or_nothing = absl::GetFlag(FLAGS_source_all_or_nothing),
+        .statement_threads = absl::GetFlag(FLAGS_statement_threads),
+        .nary_schedule = schedule,
+    };
+    if (options.jobs == 0) {
+        options.jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+    try {
+        const auto start = std::chrono::steady_clock::now();
+        const auto results = run_batch(options);
+        write_batch_summary(std::cout, results,
+                            std::chrono::steady_clock::now() - start);
+        return std::ranges::all_of(results, &Batch_Result::completed) ? 0 : 1;
+    } catch (const ExecutionException& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+}
+
+static Server* running_server = nullptr;
+
+// Serves --serve until interrupted, after any --snapshot has been mapped
+static int run_server(Walker& walker, const std::string& path) {
+    try {
+        Server server(walker, path);
+        running_server = &server;
+        std::signal(SIGPIPE, SIG_IGN);  // clients may leave at any time
+        std::signal(SIGINT, [](int) { running_server->stop(); });
+        std::signal(SIGTERM, [](int) { running_server->stop(); });
+        std::cout << "Serving on " << path << std::endl;
+        server.run();
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        running_server = nullptr;
+    } catch (const ExecutionException& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
 
 int main(const int argc, char* argv[]) {
 #ifndef NDEBUG
@@ -20,20 +107,89 @@ int main(const int argc, char* argv[]) {
 #endif
     // Set Up
     absl::SetProgramUsageMessage("Usage: " + std::string(*argv) +
-                                 " [--source <input_file>] [--help] [--version]");
+                                 " [--source <input_file>] [--profile] [--help] [--version]");
     absl::InitializeLog();
     absl::SetStderrThreshold(warning_level);  // set logging
     absl::ParseCommandLine(argc, argv);
 
+    if (const auto trace = absl::GetFlag(FLAGS_trace); trace.has_value()) {
+        if constexpr (!enable_tracing) {
+            LOG(WARNING) << "Tracing is disabled, set enable_tracing in "
+                            "config.h to record a trace";
+        } else if (!Tracer::instance().open(*trace)) {
+            LOG(ERROR) << "Failed to open trace file: " << *trace;
+        }
+    }
+
+    const auto schedule =
+        parse_nary_schedule(absl::GetFlag(FLAGS_nary_schedule));
+    if (!schedule.has_value()) {
+        std::cerr << "Unknown --nary_schedule: "
+                  << absl::GetFlag(FLAGS_nary_schedule) << '\n';
+        return 1;
+    }
+    if (const auto batch = absl::GetFlag(FLAGS_batch); batch.has_value()) {
+        return run_batch_mode(*batch, *schedule);
+    }
+
     // Start of Program
     Walker walker;
-    if (const std::optional<std::string> source = absl::GetFlag(FLAGS_source);
-        source.has_value()) {
-        const std::string& input = source.value();
-        const std::string user_input = "source " + input + ";";
-        evaluate(user_input, walker);
-        std::cout << walker.get_output();
-    } else {
+    if (const auto snapshot = absl::GetFlag(FLAGS_snapshot);
+        snapshot.has_value()) {
+        try {
+            walker.map_snapshot(*snapshot);
+            std::cout << walker.get_output();
+        } catch (const ExecutionException& e) {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+    }
+    walker.set_profiling(absl::GetFlag(FLAGS_profile));
+    walker.set_source_all_or_nothing(
+        absl::GetFlag(FLAGS_source_all_or_nothing));
+    walker.set_statement_threads(absl::GetFlag(FLAGS_statement_threads));
+    walker.set_nary_schedule(*schedule);
+    walker.set_colours(isatty(STDOUT_FILENO));
+    if (const auto serve = absl::GetFlag(FLAGS_serve); serve.has_value()) {
+        return run_server(walker, *serve);
+    }
+    const std::optional<std::string> source = absl::GetFlag(FLAGS_source);
+    if (!source.has_value() && isatty(STDIN_FILENO)) {
         repl(walker);
     }
+
+    if (source.has_value()) {
+        // Run directly rather than as a `source` statement, whose file name
+        // would have to be quoted
+        std::ifstream f(*source, std::ios::binary);
+        if (!f.is_open()) {
+            std::cerr << "Failed to open file: " << *source << '\n';
+            return 1;
+        }
+        walker.run_source(f);
+        if (f.bad()) {
+            std::cout << walker.get_output();
+            std::cerr << "Failed to read file: " << *source << '\n';
+            return 1;
+        }
+    } else {
+        // A script piped into stdin is run like a sourced file
+        walker.run_source(std::cin);
+    }
+    std::cout << walker.get_output();
+
+    if (absl::GetFlag(FLAGS_profile)) {
+        if (const auto csv = absl::GetFlag(FLAGS_profile_csv);
+            csv.has_value()) {
+            std::ofstream f(*csv);
+            if (!f.is_open()) {
+                std::cerr << "Failed to open file: " << *csv << '\n';
+                return 1;
+            }
+            walker.write_profile_csv(f);
+        } else {
+            walker.write_profile_report(std::cout,
+                                        absl::GetFlag(FLAGS_profile_top));
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "parse_pipeline.h"
+
+#include "config.h"
+#include "lexer.h"
+#include "parser.h"
+#include "trace.h"
+
+Parse_Pipeline::Parse_Pipeline(std::istream& is, const bool background)
+    : stream(is), queue(queue_capacity) {
+    if (use_parse_thread && background) {
+        producer = std::jthread([this] {
+            while (!finished) {
+                Parsed_Batch batch = read_batch_checked();
+                if (batch.statements.empty() && batch.error.empty()) break;
+                if (!queue.push(std::move(batch))) break;  // consumer stopped
+            }
+            queue.close();
+        });
+    }
+}
+
+Parse_Pipeline::~Parse_Pipeline() { queue.close(); }
+
+std::optional<Parsed_Batch> Parse_Pipeline::next() {
+    if (producer.joinable()) return queue.pop();
+    if (finished) return std::nullopt;
+    Parsed_Batch batch = read_batch_checked();
+    if (batch.statements.empty() && batch.error.empty()) return std::nullopt;
+    return batch;
+}
+
+Parsed_Batch Parse_Pipeline::read_batch_checked() {
+    // An exception would otherwise escape the producer thread and terminate
+    try {
+        return read_batch();
+    } catch (const std::exception& e) {
+        finished = true;
+        Parsed_Batch batch;
+        batch.error = std::string("Failed to read script: ") + e.what() + '\n';
+        return batch;
+    }
+}
+
+Parsed_Batch Parse_Pipeline::read_batch() {
+    const Trace_Span span{"parse_batch", "frontend"};
+    Parsed_Batch batch;
+    while (batch.statements.size() < batch_statements) {
+        const auto text = stream.next();
+        if (!text.has_value()) {
+            finished = true;
+            break;
+        }
+        const lex_result_t tokens = scan_to_tokens(*text);
+        if (!tokens.has_value()) {
+            batch.error = std::string(tokens.error().what()) + '\n';
+            finished = true;
+            break;
+        }
+        auto statements = parse(*tokens, batch.arena);
+        if (!statements.has_value()) {
+            for (const auto& error : statements.error()) {
+                batch.error += std::string(error.what()) + '\n';
+            }
+            finished = true;
+            break;
+        }
+        for (auto& statement : *statements) {
+            batch.statements.push_back(std::move(statement));
+        }
+    }
+    return batch;
+}
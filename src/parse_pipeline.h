@@ -0,0 +1,50 @@
+#pragma once
+// Lexes and parses a script on a background thread while it is being run
+//
+// The producer thread splits the input into statements (statement_stream.h),
+// parses them into batches and hands the batches to the walker through a
+// bounded queue, so that the front end overlaps with BDD construction while
+// at most queue_capacity batches of ASTs are held at once. Without thread
+// support (use_parse_thread in config.h), or when the caller asks for it,
+// batches are parsed on demand instead.
+#include <istream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ast.h"
+#include "bounded_queue.h"
+#include "statement_stream.h"
+
+struct Parsed_Batch {
+    Ast_Arena arena;  // owns the expressions of statements
+    std::vector<stmt> statements;
+    // Lexer or parser errors of the statement after the last one, which ends
+    // the script; empty otherwise
+    std::string error;
+};
+
+class Parse_Pipeline {
+    Statement_Stream stream;
+    bool finished{};  // the end of the input or an error has been reached
+    Bounded_Queue<Parsed_Batch> queue;
+    std::jthread producer;  // declared last so that it is joined first
+
+    Parsed_Batch read_batch();
+    Parsed_Batch read_batch_checked();  // reports exceptions in the error
+
+   public:
+    static constexpr size_t batch_statements = 256;
+    static constexpr size_t queue_capacity = 8;  // batches
+
+    // Parses on the calling thread, inside next(), unless background is set
+    // and threads are available
+    explicit Parse_Pipeline(std::istream& is, bool background = true);
+    ~Parse_Pipeline();  // stops the producer once its current batch is done
+    Parse_Pipeline(const Parse_Pipeline&) = delete;
+    Parse_Pipeline& operator=(const Parse_Pipeline&) = delete;
+
+    // The next batch in script order, or nullopt after the last one
+    std::optional<Parsed_Batch> next();
+};
@@ -6,15 +6,20 @@
 #include "lexer.h"
 
 // Parses a vector of tokens into an AST
-parse_result_t parse(const std::vector<token>& tokens) {
-    // Tokenise the input string
+parse_result_t parse(const std::vector<token>& tokens, Ast_Arena& arena) {
+    // Every statement ends with a ';', which the statement parsers rely on
+    // to never run past the end of the tokens
+    if (!tokens.empty() && tokens.back().type != token::Type::SEMICOLON) {
+        return std::unexpected(std::vector{ParserException(
+            "Expected ';' at the end of the input", tokens.back(), __func__)});
+    }
     auto sp = std::span(tokens);
     std::vector<stmt> statements;
     std::vector<ParserException> errors;
     bool has_errors = false;
     while (!sp.empty()) {
         try {
-            statements.emplace_back(parse_statement(sp));
+            statements.emplace_back(parse_statement(sp, arena));
         } catch (const ParserException& e) {
             has_errors = true;
             errors.push_back(e);
@@ -36,14 +41,16 @@ parse_result_t parse(const std::vector<token>& tokens) {
 }
 // Combines the lexer and the parser
 
-stmt parse_statement(const_span& sp) {
+stmt parse_statement(const_span& sp, Ast_Arena& arena) {
     switch (sp.front().type) {
         case token::Type::BVAR:
             return parse_decl(sp);
         case token::Type::SET:
-            return parse_assign(sp);
-        case token::Type::TREE_DISPLAY:
+            return parse_assign(sp, arena);
         case token::Type::GRAPH_DISPLAY:
+        case token::Type::DAG_DISPLAY:
+            return parse_display(sp, arena);
+        case token::Type::TREE_DISPLAY:
         case token::Type::IS_SAT:
         case token::Type::SOURCE:
         case token::Type::CLEAR_CACHE:
@@ -52,9 +59,19 @@ stmt parse_statement(const_span& sp) {
         case token::Type::UNPRESERVE:
         case token::Type::UNPRESERVE_ALL:
         case token::Type::SWEEP:
-            return parse_func_call(sp);
+        case token::Type::PROFILE_ON:
+        case token::Type::PROFILE_OFF:
+        case token::Type::PROFILE_REPORT:
+        case token::Type::PROFILE_CSV:
+        case token::Type::SAVE:
+        case token::Type::LOAD:
+            return parse_func_call(sp, arena);
+        case token::Type::LOAD_CNF:
+        case token::Type::LOAD_AIGER:
+        case token::Type::LOAD_BLIF:
+            return parse_import(sp, arena);
         default:  // assume expr statement
-            return parse_expr_stmt(sp);
+            return parse_expr_stmt(sp, arena);
     }
 }
 
@@ -82,10 +99,9 @@ decl_stmt parse_decl(const_span& sp) {
 }
 
 // Parse an Assignment Statement
-assign_stmt parse_assign(const_span& sp) {
-    assign_stmt assign;
+assign_stmt parse_assign(const_span& sp, Ast_Arena& arena) {
     sp = sp.subspan(1);  // skip the 'set' token
-    assign.target = parse_ident(sp);
+    assign_stmt assign{parse_ident(sp), nullptr};
 
     if (sp.front().type != token::Type::EQUAL) {
         throw ParserException("Expected '=' after identifier", sp.front(),
@@ -93,7 +109,7 @@ assign_stmt parse_assign(const_span& sp) {
     }
     sp = sp.subspan(1);  // Skip the '=' token
 
-    assign.value = parse_expr(sp);
+    assign.value = parse_expr(sp, arena);
     if (sp.front().type != token::Type::SEMICOLON) {
         throw ParserException("Expected ';' after assignment", sp.front(),
                               __func__);
@@ -103,21 +119,74 @@ assign_stmt parse_assign(const_span& sp) {
 }
 
 // Parse a Function Call Statement
-func_call_stmt parse_func_call(const_span& sp) {
+func_call_stmt parse_func_call(const_span& sp, Ast_Arena& arena) {
     func_call_stmt call{sp.front(), {}};
     sp = sp.subspan(1);  // Skip the function name token
 
     while (sp.front().type != token::Type::SEMICOLON) {
-        call.arguments.push_back(parse_expr(sp));
+        call.arguments.push_back(parse_expr(sp, arena));
+    }
+    sp = sp.subspan(1);  // Skip the ';' token
+    return call;
+}
+
+// Parse a Display Statement that can be redirected to a file
+// The optional file name and node limit follow the expression as arguments
+func_call_stmt parse_display(const_span& sp, Ast_Arena& arena) {
+    // (display_graph | display_dag) expression ('to' FILENAME)? ('limit' ID)?
+    // ';'
+    func_call_stmt call{sp.front(), {}};
+    sp = sp.subspan(1);  // Skip the function name token
+    call.arguments.push_back(parse_expr(sp, arena));
+
+    if (sp.front().type == token::Type::TO) {
+        sp = sp.subspan(1);  // Skip the 'to' token
+        call.arguments.push_back(parse_primary(sp, arena));
+    }
+    if (sp.front().type == token::Type::LIMIT) {
+        sp = sp.subspan(1);  // Skip the 'limit' token
+        if (sp.front().type != token::Type::ID) {
+            throw ParserException("Expected a number after 'limit'",
+                                  sp.front(), __func__);
+        }
+        call.arguments.push_back(parse_primary(sp, arena));
+    }
+
+    if (sp.front().type != token::Type::SEMICOLON) {
+        throw ParserException("Expected ';' after display", sp.front(),
+                              __func__);
+    }
+    sp = sp.subspan(1);  // Skip the ';' token
+    return call;
+}
+
+// Parse an Import Statement
+// The file name and the name to bind become the two arguments of the call
+func_call_stmt parse_import(const_span& sp, Ast_Arena& arena) {
+    // (load_cnf | load_aiger | load_blif) FILENAME 'as' IDENTIFIER ';'
+    func_call_stmt call{sp.front(), {}};
+    sp = sp.subspan(1);  // Skip the function name token
+    call.arguments.push_back(parse_primary(sp, arena));
+
+    if (sp.front().type != token::Type::AS) {
+        throw ParserException("Expected 'as' after file name", sp.front(),
+                              __func__);
+    }
+    sp = sp.subspan(1);  // Skip the 'as' token
+    call.arguments.push_back(arena.make(parse_ident(sp)));
+
+    if (sp.front().type != token::Type::SEMICOLON) {
+        throw ParserException("Expected ';' after import", sp.front(),
+                              __func__);
     }
     sp = sp.subspan(1);  // Skip the ';' token
     return call;
 }
 
 // Parse an Expression Statement
-expr_stmt parse_expr_stmt(const_span& sp) {
+expr_stmt parse_expr_stmt(const_span& sp, Ast_Arena& arena) {
     expr_stmt expr;
-    expr.expression = parse_expr(sp);
+    expr.expression = parse_expr(sp, arena);
 
     if (sp.front().type != token::Type::SEMICOLON) {
         throw ParserException("Expected ';' after expression", sp.front(),
@@ -128,11 +197,11 @@ expr_stmt parse_expr_stmt(const_span& sp) {
     return expr;
 }
 
-std::shared_ptr<expr> parse_expr(const_span& sp) {
-    return parse_substitute(sp);
+const expr* parse_expr(const_span& sp, Ast_Arena& arena) {
+    return parse_substitute(sp, arena);
 }
 
-std::shared_ptr<expr> parse_substitute(const_span& sp) {
+const expr* parse_substitute(const_span& sp, Ast_Arena& arena) {
     // 'sub' '{' (IDENTIFIER ':' expr (',' IDENTIFIER ':' expr)*)? '}' expr
     if (sp.front().type == token::Type::SUBSTITUTE) {
         sp = sp.subspan(1);  // Skip the 'substitute' token
@@ -150,10 +219,10 @@ std::shared_ptr<expr> parse_substitute(const_span& sp) {
                                       sp.front(), __func__);
             }
             sp = sp.subspan(1);  // Skip the ':' token
-            auto value = parse_expr(sp);
+            auto value = parse_expr(sp, arena);
 
             // Add to the substitution map
-            subs[ident->name.lexeme] = std::move(value);
+            subs[ident.name.symbol] = std::move(value);
 
             if (sp.front().type == token::Type::COMMA) {
                 sp = sp.subspan(1);  // Skip the ',' token
@@ -169,63 +238,61 @@ std::shared_ptr<expr> parse_substitute(const_span& sp) {
                                   sp.front(), __func__);
         }
         sp = sp.subspan(1);  // Skip the '}' token
-        auto body = parse_expr(sp);
+        auto body = parse_expr(sp, arena);
 
-        return std::make_shared<expr>(
+        return arena.make(
             sub_expr{std::move(subs), std::move(body)});
     }
     // If no 'substitute' keyword, just parse the expression
-    return parse_equality(sp);
+    return parse_equality(sp, arena);
 }
 
 // Handle the equivalence (==) and XOR (!=) operations
-std::shared_ptr<expr> parse_equality(const_span& sp) {
-    auto left{parse_implication(sp)};
+const expr* parse_equality(const_span& sp, Ast_Arena& arena) {
+    auto left{parse_implication(sp, arena)};
 
     if (sp.front().type == token::Type::EQUAL_EQUAL) {
         // p == q is converted to (p & q) | (!p & !q)
-        const auto op = sp.front();
         sp = sp.subspan(1);  // Skip the '==' token
-        auto right = parse_implication(sp);
+        auto right = parse_implication(sp, arena);
 
         // Create (p & q)
-        auto p_and_q = std::make_shared<expr>(
+        auto p_and_q = arena.make(
             bin_expr{left, right, token{token::Type::LAND, "&"}});
 
         // Create (!p & !q)
-        auto not_p = std::make_shared<expr>(
+        auto not_p = arena.make(
             unary_expr{std::move(left), token{token::Type::BANG, "!"}});
-        auto not_q = std::make_shared<expr>(
+        auto not_q = arena.make(
             unary_expr{std::move(right), token{token::Type::BANG, "!"}});
-        auto not_p_and_not_q = std::make_shared<expr>(bin_expr{
+        auto not_p_and_not_q = arena.make(bin_expr{
             std::move(not_p), std::move(not_q), token{token::Type::LAND, "&"}});
 
         // Create (p & q) | (!p & !q)
-        return std::make_shared<expr>(bin_expr{std::move(p_and_q),
+        return arena.make(bin_expr{std::move(p_and_q),
                                                std::move(not_p_and_not_q),
                                                token{token::Type::LOR, "|"}});
     }
 
     else if (sp.front().type == token::Type::BANG_EQUAL) {
         // p != q -> (p & !q) | (!p & q)
-        const auto op = sp.front();
         sp = sp.subspan(1);  // Skip the '!=' token
-        auto right = parse_implication(sp);
+        auto right = parse_implication(sp, arena);
 
-        auto not_p = std::make_shared<expr>(
+        auto not_p = arena.make(
             unary_expr{left, token{token::Type::BANG, "!"}});
-        auto not_q = std::make_shared<expr>(
+        auto not_q = arena.make(
             unary_expr{right, token{token::Type::BANG, "!"}});
 
         // Create (p & !q)
-        auto p_and_not_q = std::make_shared<expr>(bin_expr{
+        auto p_and_not_q = arena.make(bin_expr{
             std::move(left), std::move(not_q), token{token::Type::LAND, "&"}});
         // Create (!p & q)
-        auto not_p_and_q = std::make_shared<expr>(bin_expr{
+        auto not_p_and_q = arena.make(bin_expr{
             std::move(not_p), std::move(right), token{token::Type::LAND, "&"}});
 
         // Create (p & !q) | (!p & q)
-        return std::make_shared<expr>(bin_expr{std::move(p_and_not_q),
+        return arena.make(bin_expr{std::move(p_and_not_q),
                                                std::move(not_p_and_q),
                                                token{token::Type::LOR, "|"}});
     }
@@ -236,47 +303,46 @@ std::shared_ptr<expr> parse_equality(const_span& sp) {
 // Parse an implication
 // Looks for implications with right-associativity
 // syntactic sugar for '(not p) | q'
-std::shared_ptr<expr> parse_implication(const_span& sp) {
-    auto premise{parse_disjunct(sp)};
+const expr* parse_implication(const_span& sp, Ast_Arena& arena) {
+    auto premise{parse_disjunct(sp, arena)};
     if (!sp.empty() && sp.front().type == token::Type::ARROW) {
-        const auto op = sp.front();
         sp = sp.subspan(1);  // Skip the '->' token
-        auto conclusion = parse_implication(sp);
-        return std::make_shared<expr>(
-            bin_expr{std::make_shared<expr>(
+        auto conclusion = parse_implication(sp, arena);
+        return arena.make(
+            bin_expr{arena.make(
                          unary_expr{premise, token{token::Type::BANG, "!"}}),
                      std::move(conclusion), token{token::Type::LOR, "|"}});
     }
     return premise;
 }
 
-std::shared_ptr<expr> parse_disjunct(const_span& sp) {
-    auto conjunct{parse_conjunct(sp)};
+const expr* parse_disjunct(const_span& sp, Ast_Arena& arena) {
+    auto conjunct{parse_conjunct(sp, arena)};
     while (sp.front().type == token::Type::LOR) {
         const auto op = sp.front();
         sp = sp.subspan(1);  // Skip the '|' token
-        auto right = parse_conjunct(sp);
-        conjunct = std::make_shared<expr>(
+        auto right = parse_conjunct(sp, arena);
+        conjunct = arena.make(
             bin_expr{std::move(conjunct), std::move(right), op});
     }
     return conjunct;
 }
 
 // Parse a Conjunct Expression
-std::shared_ptr<expr> parse_conjunct(const_span& sp) {
-    auto unary_expr{parse_quantifier(sp)};
+const expr* parse_conjunct(const_span& sp, Ast_Arena& arena) {
+    auto unary_expr{parse_quantifier(sp, arena)};
     while (sp.front().type == token::Type::LAND) {
         const auto op = sp.front();
         sp = sp.subspan(1);  // Skip the '&' token
-        auto right = parse_quantifier(sp);
-        unary_expr = std::make_shared<expr>(
+        auto right = parse_quantifier(sp, arena);
+        unary_expr = arena.make(
             bin_expr{std::move(unary_expr), std::move(right), op});
     }
     return unary_expr;
 }
 
 // Parse a Quantifier Expression
-std::shared_ptr<expr> parse_quantifier(const_span& sp) {
+const expr* parse_quantifier(const_span& sp, Ast_Arena& arena) {
     // exists '(' IDENTIFIER+ ')' unary
     // forall '(' IDENTIFIER+ ')' unary
 
@@ -311,64 +377,99 @@ std::shared_ptr<expr> parse_quantifier(const_span& sp) {
                     __func__);
         }
 
-        auto body = parse_unary(sp);
-        return std::make_shared<expr>(quantifier_expr{
+        auto body = parse_unary(sp, arena);
+        return arena.make(quantifier_expr{
             quantifier, std::move(bound_vars), std::move(body)});
     } else {
         // no quantifier
-        return parse_unary(sp);
+        return parse_unary(sp, arena);
     }
 }
 
 // Parse a Unary Expression
-std::shared_ptr<expr> parse_unary(const_span& sp) {
+const expr* parse_unary(const_span& sp, Ast_Arena& arena) {
     if (sp.front().type == token::Type::BANG) {
         const auto op = sp.front();
         sp = sp.subspan(1);  // Skip the '!' token
-        auto operand = parse_unary(sp);
-        return std::make_shared<expr>(unary_expr{std::move(operand), op});
+        auto operand = parse_unary(sp, arena);
+        return arena.make(unary_expr{std::move(operand), op});
     }
-    return parse_primary(sp);
+    return parse_primary(sp, arena);
 }
 
 // Parse a Primary Expression
-std::shared_ptr<expr> parse_primary(const_span& sp) {
+const expr* parse_primary(const_span& sp, Ast_Arena& arena) {
     if (sp.front().type == token::Type::IDENTIFIER) {
-        const auto id = parse_ident(sp);
-        return std::make_shared<expr>(*id);
+        return arena.make(parse_ident(sp));
     } else if (sp.front().type == token::Type::ID ||
                sp.front().type == token::Type::TRUE ||
-               sp.front().type == token::Type::FALSE) {
-        const auto lit = parse_literal(sp);
-        return std::make_shared<expr>(*lit);
+               sp.front().type == token::Type::FALSE ||
+               sp.front().type == token::Type::STRING) {
+        return arena.make(parse_literal(sp));
     } else if (sp.front().type == token::Type::LEFT_PAREN) {
         sp = sp.subspan(1);  // Skip the '(' token
-        auto expr = parse_expr(sp);
+        auto expr = parse_expr(sp, arena);
+        if (sp.front().type != token::Type::RIGHT_PAREN) {
+            throw ParserException("Expected ')' after expression", sp.front(),
+                                  __func__);
+        }
         sp = sp.subspan(1);  // Skip the ')' token
         return expr;
+    } else if (sp.front().type == token::Type::AND_ALL ||
+               sp.front().type == token::Type::OR_ALL) {
+        return parse_nary(sp, arena);
     }
     throw ParserException("Expected identifier, literal, or '('", sp.front(),
                           __func__);
 }
 
+const expr* parse_nary(const_span& sp, Ast_Arena& arena) {
+    // ('and_all' | 'or_all') '(' (expr (',' expr)*)? ')'
+    const token op = sp.front().type == token::Type::AND_ALL
+                         ? token{token::Type::LAND, "&"}
+                         : token{token::Type::LOR, "|"};
+    sp = sp.subspan(1);  // Skip the 'and_all' or 'or_all' token
+    if (sp.front().type != token::Type::LEFT_PAREN) {
+        throw ParserException("Expected '(' after n-ary operator", sp.front(),
+                              __func__);
+    }
+    sp = sp.subspan(1);  // Skip the '(' token
+
+    std::vector<const expr*> operands;
+    if (sp.front().type != token::Type::RIGHT_PAREN) {
+        operands.push_back(parse_expr(sp, arena));
+        while (sp.front().type == token::Type::COMMA) {
+            sp = sp.subspan(1);  // Skip the ',' token
+            operands.push_back(parse_expr(sp, arena));
+        }
+    }
+    if (sp.front().type != token::Type::RIGHT_PAREN) {
+        throw ParserException("Expected ',' or ')' after operand", sp.front(),
+                              __func__);
+    }
+    sp = sp.subspan(1);  // Skip the ')' token
+    return arena.make(nary_expr{op, std::move(operands)});
+}
+
 // Parse an Identifier
-std::shared_ptr<identifier> parse_ident(const_span& sp) {
+identifier parse_ident(const_span& sp) {
     if (sp.front().type != token::Type::IDENTIFIER) {
         throw ParserException("Expected identifier", sp.front(), __func__);
     }
-    auto id = std::make_shared<identifier>(sp.front());
+    identifier id{sp.front()};
     sp = sp.subspan(1);  // Skip the identifier token
     return id;
 }
 
 // Parse a Literal
-std::shared_ptr<literal> parse_literal(const_span& sp) {
+literal parse_literal(const_span& sp) {
     if (sp.front().type != token::Type::TRUE &&
         sp.front().type != token::Type::FALSE &&
-        sp.front().type != token::Type::ID) {
+        sp.front().type != token::Type::ID &&
+        sp.front().type != token::Type::STRING) {
         throw ParserException("Expected literal", sp.front(), __func__);
     }
-    auto lit = std::make_shared<literal>(sp.front());
+    literal lit{sp.front()};
     sp = sp.subspan(1);  // Skip the literal token
     return lit;
 }
@@ -14,52 +14,61 @@ using const_span = std::span<const token>;
 // Parses a vector of expressions into an Abstract Syntax Tree (AST)
 using parse_result_t =
     std::expected<std::vector<stmt>, std::vector<ParserException>>;
-parse_result_t parse(const std::vector<token>& tokens);
+parse_result_t parse(const std::vector<token>& tokens, Ast_Arena& arena);
 
 // Parses a single statement
-stmt parse_statement(const_span& sp);
+stmt parse_statement(const_span& sp, Ast_Arena& arena);
 
 // Parses a Declaration Statement
 decl_stmt parse_decl(const_span& sp);
 
 // Parses an Assignment Statement
-assign_stmt parse_assign(const_span& sp);
+assign_stmt parse_assign(const_span& sp, Ast_Arena& arena);
 
 // Parses a Display Statement
-func_call_stmt parse_func_call(const_span& sp);
+func_call_stmt parse_func_call(const_span& sp, Ast_Arena& arena);
+
+// Parses an Import Statement
+func_call_stmt parse_import(const_span& sp, Ast_Arena& arena);
+
+// Parses a Display Statement with an optional file and node limit
+func_call_stmt parse_display(const_span& sp, Ast_Arena& arena);
 
 // Parse an Expression Statement
-expr_stmt parse_expr_stmt(const_span& sp);
+expr_stmt parse_expr_stmt(const_span& sp, Ast_Arena& arena);
 
 // Parses an Expression
-std::shared_ptr<expr> parse_expr(const_span& sp);
+const expr* parse_expr(const_span& sp, Ast_Arena& arena);
 
 // Parses an Expression
-std::shared_ptr<expr> parse_substitute(const_span& sp);
+const expr* parse_substitute(const_span& sp, Ast_Arena& arena);
 
 // Parses an Equality Expression
-std::shared_ptr<expr> parse_equality(const_span& sp);
+const expr* parse_equality(const_span& sp, Ast_Arena& arena);
 
 // Parses an Implication Expression
-std::shared_ptr<expr> parse_implication(const_span& sp);
+const expr* parse_implication(const_span& sp, Ast_Arena& arena);
 
 // Parses a Disjunction Expression
-std::shared_ptr<expr> parse_disjunct(const_span& sp);
+const expr* parse_disjunct(const_span& sp, Ast_Arena& arena);
 
 // Parses a Conjunct Expression
-std::shared_ptr<expr> parse_conjunct(const_span& sp);
+const expr* parse_conjunct(const_span& sp, Ast_Arena& arena);
 
 // Prases a Quantifier Expression
-std::shared_ptr<expr> parse_quantifier(const_span& sp);
+const expr* parse_quantifier(const_span& sp, Ast_Arena& arena);
 
 // Parses a Unary Expression
-std::shared_ptr<expr> parse_unary(const_span& sp);
+const expr* parse_unary(const_span& sp, Ast_Arena& arena);
 
 // Parses a Primary Expression
-std::shared_ptr<expr> parse_primary(const_span& sp);
+const expr* parse_primary(const_span& sp, Ast_Arena& arena);
+
+// Parses an and_all or or_all Expression
+const expr* parse_nary(const_span& sp, Ast_Arena& arena);
 
 // Parses an Identifier
-std::shared_ptr<identifier> parse_ident(const_span& sp);
+identifier parse_ident(const_span& sp);
 
 // Parses a Literal
-std::shared_ptr<literal> parse_literal(const_span& sp);
+literal parse_literal(const_span& sp);
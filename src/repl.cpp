@@ -9,9 +9,13 @@
 #include "config.h"
 #include "lexer.h"
 #include "parser.h"
+#include "trace.h"
 
 void evaluate(const std::string& user_input, Walker& walker) {
-    const lex_result_t tokens = scan_to_tokens(user_input);
+    const lex_result_t tokens = [&] {
+        const Trace_Span span{"lex", "frontend"};
+        return scan_to_tokens(user_input);
+    }();
     if (!tokens.has_value()) {
         set_colour(std::cout, Colour::RED);
         std::cout << tokens.error().what() << '\n';
@@ -29,7 +33,11 @@ void evaluate(const std::string& user_input, Walker& walker) {
         }
     }
 
-    auto estmt = parse(*tokens);
+    Ast_Arena arena;  // the whole input is freed at once after walking
+    auto estmt = [&] {
+        const Trace_Span span{"parse", "frontend"};
+        return parse(*tokens, arena);
+    }();
     std::vector<stmt> statements = {};
 
     if (!estmt.has_value()) {
@@ -44,6 +52,7 @@ void evaluate(const std::string& user_input, Walker& walker) {
     walker.walk_statements(*estmt);
 
     std::cout << walker.get_output();
+    Tracer::instance().flush();
 }
 
 [[noreturn]] void repl(Walker& walker) {
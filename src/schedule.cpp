@@ -0,0 +1,68 @@
+#include "schedule.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+std::optional<Stmt_Access> access_of(const assign_stmt& statement) {
+    // Expressions are DAGs, so each node is visited once
+    std::unordered_set<const expr*> visited;
+    std::unordered_set<symbol_id> reads;
+    std::vector<const expr*> stack{statement.value};
+    while (!stack.empty()) {
+        const expr* x = stack.back();
+        stack.pop_back();
+        if (!visited.insert(x).second) continue;
+
+        if (const auto* id = std::get_if<identifier>(x)) {
+            reads.insert(id->name.symbol);
+        } else if (const auto* lit = std::get_if<literal>(x)) {
+            if (lit->value.type == token::Type::ID) return std::nullopt;
+        } else if (const auto* bin = std::get_if<bin_expr>(x)) {
+            stack.push_back(bin->left);
+            stack.push_back(bin->right);
+        } else if (const auto* unary = std::get_if<unary_expr>(x)) {
+            stack.push_back(unary->operand);
+        } else if (const auto* quant = std::get_if<quantifier_expr>(x)) {
+            stack.push_back(quant->body);
+        } else if (const auto* nary = std::get_if<nary_expr>(x)) {
+            stack.insert(stack.end(), nary->operands.begin(),
+                         nary->operands.end());
+        } else if (const auto* sub = std::get_if<sub_expr>(x)) {
+            stack.push_back(sub->body);
+            for (const auto& [symbol, value] : sub->substitutions) {
+                reads.insert(symbol);
+                stack.push_back(value);
+            }
+        }
+    }
+    return Stmt_Access{{reads.begin(), reads.end()},
+                       statement.target.name.symbol};
+}
+
+std::vector<uint32_t> schedule_waves(
+    const std::span<const Stmt_Access> accesses) {
+    // Latest wave that writes and that reads each name so far
+    std::unordered_map<symbol_id, uint32_t> written;
+    std::unordered_map<symbol_id, uint32_t> read;
+    const auto after = [](const auto& waves, const symbol_id name) {
+        const auto it = waves.find(name);
+        return it == waves.end() ? 0u : it->second + 1;
+    };
+
+    std::vector<uint32_t> waves;
+    waves.reserve(accesses.size());
+    for (const auto& [reads, write] : accesses) {
+        uint32_t wave = std::max(after(written, write), after(read, write));
+        for (const symbol_id name : reads) {
+            wave = std::max(wave, after(written, name));
+        }
+        for (const symbol_id name : reads) {
+            auto& latest = read[name];
+            latest = std::max(latest, wave);
+        }
+        written[write] = wave;
+        waves.push_back(wave);
+    }
+    return waves;
+}
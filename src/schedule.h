@@ -0,0 +1,27 @@
+#pragma once
+// Dependencies between assignments, so that a run of `set` statements can be
+// evaluated concurrently (see Walker::walk_concurrent)
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "ast.h"
+
+// The global names a statement reads and the one it writes
+struct Stmt_Access {
+    std::vector<symbol_id> reads;  // distinct
+    symbol_id write{};
+};
+
+// Names read by the value of an assignment, or nullopt if it refers to a node
+// by ID, which depends on the order nodes were created in
+std::optional<Stmt_Access> access_of(const assign_stmt& statement);
+
+// Statement j depends on an earlier statement i if it reads the name i
+// writes, writes a name i reads or writes the same name. Returns the wave of
+// each statement: 0 without dependencies, otherwise one more than the latest
+// wave it depends on. The statements of a wave are independent of each other,
+// and running the waves in order gives the same bindings as running the
+// statements in order.
+std::vector<uint32_t> schedule_waves(std::span<const Stmt_Access> accesses);
@@ -0,0 +1,298 @@
+#include "server.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "absl/log/log.h"
+#include "engine_exceptions.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // SIGPIPE has to be ignored instead
+#endif
+
+namespace {
+constexpr size_t header_size = 4;
+constexpr size_t queued_requests = 64;  // beyond this, clients are not read
+constexpr int shutdown_grace_ms = 1000;
+
+uint32_t decode_length(const char* header) {
+    uint32_t length = 0;
+    for (size_t i = 0; i < header_size; ++i) {
+        length = length << 8 | static_cast<unsigned char>(header[i]);
+    }
+    return length;
+}
+
+bool write_all(const int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool read_all(const int fd, char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t n = read(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+sockaddr_un address_of(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw ExecutionException("Socket path too long: " + path,
+                                 "Server::Server");
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+// A socket file is stale if nothing accepts connections on it any more
+bool is_stale_socket(const std::string& path) {
+    struct stat info{};
+    if (stat(path.c_str(), &info) != 0 || !S_ISSOCK(info.st_mode)) {
+        return false;
+    }
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    const sockaddr_un address = address_of(path);
+    const bool live = connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                              sizeof(address)) == 0;
+    close(fd);
+    return !live;
+}
+
+// The length header of a frame holding size bytes
+std::array<char, header_size> frame_header(const size_t size) {
+    const auto length = static_cast<uint32_t>(size);
+    return {static_cast<char>(length >> 24), static_cast<char>(length >> 16),
+            static_cast<char>(length >> 8), static_cast<char>(length)};
+}
+}  // namespace
+
+bool write_frame(const int fd, const std::string_view payload) {
+    if (payload.size() > max_frame_size) return false;
+    const auto header = frame_header(payload.size());
+    return write_all(fd, header.data(), header.size()) &&
+           write_all(fd, payload.data(), payload.size());
+}
+
+std::optional<std::string> read_frame(const int fd) {
+    std::array<char, header_size> header{};
+    if (!read_all(fd, header.data(), header.size())) return std::nullopt;
+    const uint32_t length = decode_length(header.data());
+    if (length > max_frame_size) return std::nullopt;
+    std::string payload(length, '\0');
+    if (!read_all(fd, payload.data(), length)) return std::nullopt;
+    return payload;
+}
+
+Server::Connection::~Connection() { close(fd); }
+
+Server::Server(Walker& walker, std::string path)
+    : walker(walker), path(std::move(path)), requests(queued_requests) {
+    const sockaddr_un address = address_of(this->path);
+    if (is_stale_socket(this->path)) unlink(this->path.c_str());
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 || pipe(wake_fds) != 0 ||
+        fcntl(wake_fds[0], F_SETFL, O_NONBLOCK) != 0 ||
+        fcntl(wake_fds[1], F_SETFL, O_NONBLOCK) != 0) {
+        close(listen_fd);
+        throw ExecutionException(
+            std::string("Failed to create socket: ") + std::strerror(errno),
+            __func__);
+    }
+    if (bind(listen_fd, reinterpret_cast<const sockaddr*>(&address),
+             sizeof(address)) != 0 ||
+        listen(listen_fd, SOMAXCONN) != 0) {
+        const std::string reason = std::strerror(errno);
+        close(listen_fd);
+        close(wake_fds[0]);
+        close(wake_fds[1]);
+        throw ExecutionException(
+            "Failed to listen on " + this->path + ": " + reason, __func__);
+    }
+}
+
+Server::~Server() {
+    stop();
+    if (io_thread.joinable()) io_thread.join();
+    close(listen_fd);
+    close(wake_fds[0]);
+    close(wake_fds[1]);
+    unlink(path.c_str());
+}
+
+// A full pipe already wakes the poll loop, so the write may fail
+void Server::wake() {
+    const char byte = 0;
+    [[maybe_unused]] const ssize_t n = write(wake_fds[1], &byte, 1);
+}
+
+void Server::stop() {
+    stopping = true;
+    wake();
+}
+
+void Server::run() {
+    walker.set_colours(false);  // responses go to sockets, not terminals
+    io_thread = std::jthread([this] { io_loop(); });
+    while (auto request = requests.pop()) {
+        std::istringstream script(std::move(request->script));
+        const bool completed = walker.run_source(script);
+        std::string response = (completed ? "0" : "1") + walker.get_output();
+        const auto header = frame_header(response.size());
+        response.insert(0, header.data(), header.size());
+        {
+            const std::lock_guard lock(responses_mutex);
+            responses.push_back({std::move(request->client),
+                                 std::move(response)});
+        }
+        wake();
+    }
+    {
+        const std::lock_guard lock(responses_mutex);
+        finished = true;
+    }
+    wake();
+    io_thread.join();
+}
+
+void Server::io_loop() {
+    std::vector<std::shared_ptr<Connection>> clients;
+    std::vector<pollfd> fds;
+    std::array<char, 1 << 16> chunk{};
+    bool closed = false;  // the request queue, once stopping
+    bool done = false;    // run() has handed over its last response
+
+    // Writes as much of a client's responses as its socket accepts, and
+    // returns false if the client has to be dropped
+    const auto flush = [](Connection& client) {
+        while (!client.unsent.empty()) {
+            const ssize_t n =
+                send(client.fd, client.unsent.data(), client.unsent.size(),
+                     MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (n <= 0) return false;
+            client.unsent.erase(0, static_cast<size_t>(n));
+        }
+        return client.unsent.size() <= max_frame_size;
+    };
+    while (true) {
+        if (stopping && !closed) {
+            requests.close();  // run() finishes what is queued and returns
+            closed = true;
+        }
+        const bool unsent = std::ranges::any_of(
+            clients, [](const auto& c) { return !c->unsent.empty(); });
+        if (done && !unsent) break;
+
+        // The wake pipe, the listening socket and then every client. Once
+        // stopping, nothing new is read and only responses are written.
+        fds.assign({{wake_fds[0], POLLIN, 0},
+                    {listen_fd, static_cast<short>(closed ? 0 : POLLIN), 0}});
+        // A client with nothing to do is left out (fd -1), as poll would
+        // keep reporting a hang up
+        for (const auto& client : clients) {
+            short events = client->unsent.empty() ? 0 : POLLOUT;
+            if (client->reading && !closed) events |= POLLIN;
+            fds.push_back({events == 0 ? -1 : client->fd, events, 0});
+        }
+        const int ready =
+            poll(fds.data(), fds.size(), done ? shutdown_grace_ms : -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            LOG(ERROR) << "poll failed: " << std::strerror(errno);
+            break;
+        }
+        if (ready == 0) break;  // clients left unread at shutdown
+
+        // Requests are queued in the order their last bytes were read
+        for (size_t i = 0; i < clients.size(); ++i) {
+            const short revents = fds[i + 2].revents;
+            if (revents == 0) continue;
+            Connection& client = *clients[i];
+            bool open = true;
+            if ((revents & POLLOUT) != 0) open = flush(client);
+            if (client.reading && !closed &&
+                (revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+                const ssize_t n = read(client.fd, chunk.data(), chunk.size());
+                if (n > 0) client.buffer.append(chunk.data(), n);
+                client.reading = n > 0 || (n < 0 && errno == EINTR);
+            }
+            while (client.reading && client.buffer.size() >= header_size) {
+                const uint32_t length = decode_length(client.buffer.data());
+                if (length > max_frame_size) {
+                    client.reading = false;
+                } else if (client.buffer.size() >= header_size + length) {
+                    if (requests.push(
+                            {clients[i],
+                             client.buffer.substr(header_size, length)})) {
+                        ++client.unanswered;
+                    }
+                    client.buffer.erase(0, header_size + length);
+                } else {
+                    break;
+                }
+            }
+            // Kept until every request it sent has been answered
+            if (!open || (revents & POLLERR) != 0 ||
+                (!client.reading && client.unanswered == 0 &&
+                 client.unsent.empty())) {
+                clients[i].reset();
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            while (read(wake_fds[0], chunk.data(), chunk.size()) > 0) {
+            }
+            std::vector<Response> ready_responses;
+            {
+                const std::lock_guard lock(responses_mutex);
+                ready_responses.swap(responses);
+                done = finished;
+            }
+            for (auto& [client, frame] : ready_responses) {
+                --client->unanswered;
+                client->unsent += frame;
+                // A client that has gone away just misses its response
+                if (!flush(*client) || (!client->reading &&
+                                        client->unanswered == 0 &&
+                                        client->unsent.empty())) {
+                    std::ranges::replace(clients, client, nullptr);
+                }
+            }
+        }
+        std::erase(clients, nullptr);
+
+        if (fds[1].revents & POLLIN) {
+            if (const int fd = accept(listen_fd, nullptr, nullptr); fd >= 0) {
+                clients.push_back(std::make_shared<Connection>(fd));
+            }
+        }
+    }
+    if (!closed) requests.close();
+}
@@ -0,0 +1,88 @@
+#pragma once
+// Server mode: one persistent Walker answering scripts sent over a Unix
+// domain socket, so that its nodes, bindings and caches stay warm between
+// requests instead of being rebuilt by a new process for every query
+//
+// Every message is a frame: a 4 byte big-endian length and then that many
+// bytes. A request holds a script, which is run like `source`. The response
+// holds a status byte, '0' if the script ran to the end or '1' if it stopped
+// on an error, followed by the script's output. Any number of clients may
+// connect and send several requests each; requests run one at a time in the
+// order they arrive, and each client gets its responses in order.
+//
+// Responses are written by the I/O thread as each client's socket accepts
+// them, so a client that stops reading only delays itself. One that lets
+// more than max_frame_size bytes of responses pile up is disconnected.
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "walker.h"
+
+constexpr size_t max_frame_size = size_t{1} << 28;
+
+// Blocking frame I/O on a socket; false or nullopt once the peer has gone or
+// sent a frame larger than max_frame_size
+bool write_frame(int fd, std::string_view payload);
+std::optional<std::string> read_frame(int fd);
+
+class Server {
+    // Closed once neither the poll loop nor a queued request refers to it.
+    // Only the I/O thread uses the fields besides fd.
+    struct Connection {
+        int fd;
+        std::string buffer;    // bytes of incomplete frames
+        std::string unsent;    // of responses, written when fd is writable
+        size_t unanswered{};   // requests queued for run()
+        bool reading{true};    // until the client stops sending
+        explicit Connection(const int fd) : fd(fd) {}
+        ~Connection();
+        Connection(const Connection&) = delete;
+        Connection& operator=(const Connection&) = delete;
+    };
+    struct Request {
+        std::shared_ptr<Connection> client;
+        std::string script;
+    };
+    struct Response {
+        std::shared_ptr<Connection> client;
+        std::string frame;
+    };
+
+    Walker& walker;
+    std::string path;
+    int listen_fd{-1};
+    // stop() and run() write to a non-blocking pipe to wake the poll loop
+    int wake_fds[2]{-1, -1};
+    std::atomic<bool> stopping{false};
+    Bounded_Queue<Request> requests;
+    std::mutex responses_mutex;
+    std::vector<Response> responses;  // from run() to the poll loop
+    bool finished{};                  // run() has answered every request
+    std::jthread io_thread;
+
+    void wake();
+    // Accepts connections, reads requests and writes responses
+    void io_loop();
+
+   public:
+    // Listens on a new socket at path, replacing a stale socket file left by
+    // a server that has exited. Throws ExecutionException.
+    Server(Walker& walker, std::string path);
+    ~Server();
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Runs requests on the calling thread until stop() is called, finishing
+    // the ones already received. Responses still unsent at that point are
+    // given shutdown_grace to be read.
+    void run();
+    // Can be called from any thread or from a signal handler
+    void stop();
+};
@@ -0,0 +1,220 @@
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <format>
+#include <unordered_set>
+
+#include "engine_exceptions.h"
+
+namespace {
+constexpr char snapshot_magic[8] = {'B', 'D', 'D', 'S', 'N', 'A', 'P', '1'};
+
+// Reads successive fields, throwing instead of running off the end
+class Reader {
+    std::span<const char> data;
+
+   public:
+    explicit Reader(const std::span<const char> d) : data(d) {}
+
+    std::span<const char> take(const size_t n) {
+        if (n > data.size()) {
+            throw ExecutionException("Truncated snapshot", "Snapshot_View");
+        }
+        const auto result = data.first(n);
+        data = data.subspan(n);
+        return result;
+    }
+    uint32_t u32() {
+        uint32_t value{};
+        std::memcpy(&value, take(sizeof(value)).data(), sizeof(value));
+        return value;
+    }
+    std::string name() {
+        const auto bytes = take(u32());
+        return {bytes.begin(), bytes.end()};
+    }
+    template <typename T>
+    std::span<const T> array(const size_t count) {
+        if (count > data.size() / sizeof(T)) {
+            throw ExecutionException("Truncated snapshot", "Snapshot_View");
+        }
+        const auto bytes = take(count * sizeof(T));
+        return {reinterpret_cast<const T*>(bytes.data()), count};
+    }
+};
+
+void write_u32(std::ostream& os, const uint32_t value) {
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void write_name(std::ostream& os, const std::string_view name) {
+    write_u32(os, static_cast<uint32_t>(name.size()));
+    os.write(name.data(), static_cast<std::streamsize>(name.size()));
+}
+
+// The 3 padding bytes after Bdd_Node::type hold whatever was in memory, so
+// nodes are copied field by field into zeroed records, a block at a time,
+// to make the file depend only on the session
+void write_nodes(std::ostream& os, const std::span<const Bdd_Node> nodes) {
+    constexpr size_t block_nodes = 4096;
+    std::vector<char> block;
+    for (size_t first = 0; first < nodes.size(); first += block_nodes) {
+        const auto part = nodes.subspan(
+            first, std::min(block_nodes, nodes.size() - first));
+        block.assign(part.size_bytes(), 0);
+        char* record = block.data();
+        for (const auto& node : part) {
+            std::memcpy(record + offsetof(Bdd_Node, type), &node.type,
+                        sizeof(node.type));
+            std::memcpy(record + offsetof(Bdd_Node, var), &node.var,
+                        sizeof(node.var));
+            std::memcpy(record + offsetof(Bdd_Node, high), &node.high,
+                        sizeof(node.high));
+            std::memcpy(record + offsetof(Bdd_Node, low), &node.low,
+                        sizeof(node.low));
+            record += sizeof(Bdd_Node);
+        }
+        os.write(block.data(), static_cast<std::streamsize>(block.size()));
+    }
+}
+}  // namespace
+
+Snapshot_View::Snapshot_View(const std::span<const char> data) {
+    Reader reader(data);
+    Snapshot_Header header{};
+    std::memcpy(&header, reader.take(sizeof(header)).data(), sizeof(header));
+    if (!std::ranges::equal(header.magic, snapshot_magic)) {
+        throw ExecutionException("Not a snapshot file", __func__);
+    }
+
+    // Probing relies on a power of two table with at least one empty slot
+    if (header.num_nodes < 2 || !std::has_single_bit(header.index_slots) ||
+        header.index_slots <= header.num_nodes - 2) {
+        throw ExecutionException("Malformed snapshot header", __func__);
+    }
+    nodes = reader.array<Bdd_Node>(header.num_nodes);
+    index = reader.array<id_type>(header.index_slots);
+    if (nodes[0].type != Bdd_Node::Bdd_type::FALSE ||
+        nodes[1].type != Bdd_Node::Bdd_type::TRUE) {
+        throw ExecutionException("Malformed snapshot terminals", __func__);
+    }
+
+    for (uint32_t i = 0; i < header.num_vars; ++i) {
+        vars.push_back(reader.name());
+    }
+    if (std::unordered_set<std::string_view> unique(vars.begin(), vars.end());
+        unique.size() != vars.size()) {
+        throw ExecutionException("Duplicate variable in snapshot", __func__);
+    }
+    for (uint32_t i = 0; i < header.num_bindings; ++i) {
+        Snapshot_Binding binding{reader.name(), reader.u32(),
+                                 reader.take(1)[0] == 1};
+        if (binding.node >= nodes.size()) {
+            throw ExecutionException(
+                "Malformed binding in snapshot: " + binding.name, __func__);
+        }
+        bindings.push_back(std::move(binding));
+    }
+}
+
+std::optional<id_type> Snapshot_View::find(const Bdd_Node& node) const {
+    const size_t mask = index.size() - 1;
+    size_t slot = snapshot_hash(node) & mask;
+    for (size_t probes = 0; probes < index.size(); ++probes) {
+        const id_type id = index[slot];
+        if (id == 0 || id >= nodes.size()) return std::nullopt;
+        if (nodes[id] == node) return id;
+        slot = (slot + 1) & mask;
+    }
+    return std::nullopt;
+}
+
+void Snapshot_View::validate() const {
+    // Children must exist and lie strictly below their parent, which also
+    // rules out cycles
+    const auto num_vars = static_cast<uint32_t>(vars.size());
+    for (id_type id = 2; id < nodes.size(); ++id) {
+        const auto& [type, var, high, low] = nodes[id];
+        if (type != Bdd_Node::Bdd_type::INTERNAL || var >= num_vars ||
+            high >= id || low >= id || high == low || nodes[high].var <= var ||
+            nodes[low].var <= var) {
+            throw ExecutionException(
+                std::format("Malformed node {} in snapshot", id), __func__);
+        }
+    }
+}
+
+void write_snapshot(std::ostream& os, const std::span<const Bdd_Node> nodes,
+                    const std::span<const std::string_view> vars,
+                    const std::vector<Snapshot_Binding>& bindings) {
+    // At most half full, so that probes stay short
+    const size_t internal = nodes.size() - 2;
+    std::vector<id_type> index(
+        std::bit_ceil(std::max<size_t>(4, 2 * internal)));
+    const size_t mask = index.size() - 1;
+    for (id_type id = 2; id < nodes.size(); ++id) {
+        size_t slot = snapshot_hash(nodes[id]) & mask;
+        while (index[slot] != 0) slot = (slot + 1) & mask;
+        index[slot] = id;
+    }
+
+    Snapshot_Header header{};
+    std::ranges::copy(snapshot_magic, header.magic);
+    header.num_vars = static_cast<uint32_t>(vars.size());
+    header.num_nodes = static_cast<uint32_t>(nodes.size());
+    header.num_bindings = static_cast<uint32_t>(bindings.size());
+    header.index_slots = static_cast<uint32_t>(index.size());
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_nodes(os, nodes);
+    os.write(reinterpret_cast<const char*>(index.data()),
+             static_cast<std::streamsize>(index.size() * sizeof(id_type)));
+
+    for (const auto& var : vars) write_name(os, var);
+    for (const auto& [name, node, preserved] : bindings) {
+        write_name(os, name);
+        write_u32(os, node);
+        os.put(static_cast<char>(preserved));
+    }
+}
+
+Mapped_Snapshot::Mapped_Snapshot(void* address, const size_t length)
+    : address(address),
+      length(length),
+      view(std::span(static_cast<const char*>(address), length)) {}
+
+Mapped_Snapshot::~Mapped_Snapshot() { munmap(address, length); }
+
+std::shared_ptr<const Mapped_Snapshot> Mapped_Snapshot::open(
+    const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw ExecutionException("Failed to open file: " + path, __func__);
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        throw ExecutionException("Not a snapshot file: " + path, __func__);
+    }
+    const auto length = static_cast<size_t>(st.st_size);
+    void* address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // the mapping keeps the file alive
+    if (address == MAP_FAILED) {
+        throw ExecutionException("Failed to map file: " + path, __func__);
+    }
+
+    try {
+        return std::shared_ptr<const Mapped_Snapshot>(
+            new Mapped_Snapshot(address, length));
+    } catch (...) {
+        munmap(address, length);  // the view rejected the file
+        throw;
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+// On-disk snapshot format, shared by save/load and the --snapshot base layer
+//
+// Layout (native byte order, every integer a uint32 unless noted):
+//   header   magic "BDDSNAP1", num_vars, num_nodes, num_bindings, index_slots
+//   nodes    num_nodes Bdd_Node records indexed by id, 0 and 1 being the
+//            terminals. Children always have smaller ids than their parents.
+//   index    index_slots ids forming an open-addressing hash table over the
+//            internal nodes, probed linearly from snapshot_hash (0 is empty)
+//   vars     num_vars names, in bdd_ordering order
+//   bindings num_bindings records {name, node, preserved (uint8)}
+// Names are a length followed by the bytes. Nodes and index come first and are
+// aligned so that a mapped file can be used in place.
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "walker.h"
+
+struct Snapshot_Header {
+    char magic[8];
+    uint32_t num_vars;
+    uint32_t num_nodes;  // including the terminals
+    uint32_t num_bindings;
+    uint32_t index_slots;  // a power of two
+};
+// Written as it is in memory, so it must have no padding bytes
+static_assert(sizeof(Snapshot_Header) == 24 &&
+              std::has_unique_object_representations_v<Snapshot_Header>);
+
+struct Snapshot_Binding {
+    std::string name;
+    id_type node;
+    bool preserved;
+};
+
+// Unlike absl::Hash, this must give the same value in every process
+inline uint64_t snapshot_hash(const Bdd_Node& node) {
+    uint64_t h = (static_cast<uint64_t>(node.var) << 32 | node.high) *
+                 0x9e3779b97f4a7c15ULL;
+    h ^= (h >> 29) ^ (node.low * 0xc2b2ae3d27d4eb4fULL);
+    return h ^ (h >> 32);
+}
+
+// Bounds-checked view of a snapshot in memory. Construction reads the header,
+// names and bindings, but not the nodes or index, so that opening a mapped
+// file does not page it in. Throws ExecutionException on malformed input,
+// including a variable name given twice.
+class Snapshot_View {
+   public:
+    std::span<const Bdd_Node> nodes;
+    std::span<const id_type> index;
+    std::vector<std::string> vars;
+    std::vector<Snapshot_Binding> bindings;
+
+    explicit Snapshot_View(std::span<const char> data);
+    std::optional<id_type> find(const Bdd_Node& node) const;
+    // Checks every node, which reads the whole node array. Throws
+    // ExecutionException on the first malformed node.
+    void validate() const;
+};
+
+// nodes must be indexed by id and start with the two terminals
+void write_snapshot(std::ostream& os, std::span<const Bdd_Node> nodes,
+                    std::span<const std::string_view> vars,
+                    const std::vector<Snapshot_Binding>& bindings);
+
+// A snapshot file mapped read-only. The pages are shared through the page
+// cache by every process mapping the same file and are only read on demand.
+class Mapped_Snapshot {
+    void* address;
+    size_t length;
+
+    Mapped_Snapshot(void* address, size_t length);
+
+   public:
+    const Snapshot_View view;
+
+    // Throws ExecutionException if the file cannot be mapped or is malformed.
+    // Only the header, names and bindings are checked, so that opening costs
+    // the same for any number of nodes; users of the nodes check each one
+    // when they read it (see Walker::node_of).
+    static std::shared_ptr<const Mapped_Snapshot> open(const std::string& path);
+    ~Mapped_Snapshot();
+    Mapped_Snapshot(const Mapped_Snapshot&) = delete;
+    Mapped_Snapshot& operator=(const Mapped_Snapshot&) = delete;
+
+    std::optional<id_type> find(const Bdd_Node& node) const {
+        return view.find(node);
+    }
+};
@@ -0,0 +1,37 @@
+#include "statement_stream.h"
+
+std::optional<std::string_view> Statement_Stream::next() {
+    while (true) {
+        for (; scanned < buffer.size(); ++scanned) {
+            const char c = buffer[scanned];
+            if (c == '"') {
+                in_string = !in_string;
+            } else if (c == '\n') {
+                in_string = false;  // as in the lexer, strings end at a line
+            } else if (c == ';' && !in_string) {
+                const std::string_view text(buffer.data() + start,
+                                            scanned + 1 - start);
+                start = ++scanned;
+                return text;
+            }
+        }
+
+        // Statements already returned are dropped before reading more, so
+        // the buffer is only shifted once per chunk
+        buffer.erase(0, start);
+        scanned -= start;
+        start = 0;
+        const size_t old_size = buffer.size();
+        buffer.resize(old_size + chunk_size);
+        in.read(buffer.data() + old_size, chunk_size);
+        buffer.resize(old_size + static_cast<size_t>(in.gcount()));
+        if (buffer.size() == old_size) break;  // end of the input
+    }
+
+    const std::string_view rest = std::string_view(buffer).substr(start);
+    start = scanned = buffer.size();
+    if (rest.find_first_not_of(" \t\r\n") == std::string_view::npos) {
+        return std::nullopt;
+    }
+    return rest;
+}
@@ -0,0 +1,32 @@
+#pragma once
+// Splits a script into statements as it is read
+//
+// The input is read in fixed size chunks and cut after every ';' outside a
+// string literal, so that each statement can be lexed, parsed and run before
+// the rest of the input is read. Only the statements of the current chunk are
+// held in memory, whatever the size of the script.
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+class Statement_Stream {
+    std::istream& in;
+    std::string buffer;  // the chunk being split and any unfinished statement
+    size_t start{};      // of the next statement in buffer
+    size_t scanned{};    // buffer[start, scanned) holds no statement end
+    bool in_string{};    // the scan stopped inside a string literal
+
+   public:
+    static constexpr size_t chunk_size = 1 << 16;
+
+    explicit Statement_Stream(std::istream& is) : in(is) {}
+
+    // The text of the next statement including its ';', valid until the next
+    // call, or nullopt at the end of the input. Text after the last ';' is
+    // returned as a final statement so that its error is reported.
+    std::optional<std::string_view> next();
+
+    // Whether reading failed other than by reaching the end of the input
+    bool bad() const { return in.bad(); }
+};
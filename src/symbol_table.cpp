@@ -0,0 +1,36 @@
+#include "symbol_table.h"
+
+#include <mutex>
+
+Symbol_Table& Symbol_Table::instance() {
+    static Symbol_Table table;
+    return table;
+}
+
+Symbol Symbol_Table::intern(const std::string_view name) {
+    {
+        const std::shared_lock lock(mutex);
+        if (const auto it = ids.find(name); it != ids.end()) {
+            return {it->second, it->first};
+        }
+    }
+    const std::unique_lock lock(mutex);
+    // Another thread may have added it between the two locks
+    if (const auto it = ids.find(name); it != ids.end()) {
+        return {it->second, it->first};
+    }
+    const auto id = static_cast<symbol_id>(names.size());
+    const std::string_view stored = names.emplace_back(name);
+    ids.emplace(stored, id);
+    return {id, stored};
+}
+
+std::string_view Symbol_Table::name(const symbol_id id) const {
+    const std::shared_lock lock(mutex);
+    return names.at(id);
+}
+
+size_t Symbol_Table::size() const {
+    const std::shared_lock lock(mutex);
+    return names.size();
+}
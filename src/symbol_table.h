@@ -0,0 +1,42 @@
+#pragma once
+// Interned names shared by the lexer, the parser and every Walker.
+// Each distinct name is copied once into storage that never moves, so the
+// views handed out stay valid for the life of the process, however short
+// lived the source text they were lexed from. Two names are equal exactly
+// when their ids are, which makes ids cheap map keys.
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using symbol_id = uint32_t;
+
+struct Symbol {
+    symbol_id id;
+    std::string_view name;  // interned
+};
+
+class Symbol_Table {
+    mutable std::shared_mutex mutex;  // lexing may run on several threads
+    std::deque<std::string> names;    // by id; growing keeps elements in place
+    std::unordered_map<std::string_view, symbol_id> ids;
+
+    Symbol_Table() = default;
+
+   public:
+    Symbol_Table(const Symbol_Table&) = delete;
+    Symbol_Table& operator=(const Symbol_Table&) = delete;
+
+    static Symbol_Table& instance();
+
+    // Only copies name the first time it is seen
+    Symbol intern(std::string_view name);
+    std::string_view name(symbol_id id) const;
+    size_t size() const;
+};
+
+inline Symbol intern(const std::string_view name) {
+    return Symbol_Table::instance().intern(name);
+}
@@ -1,6 +1,11 @@
 #pragma once
 #include <cassert>
 #include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "symbol_table.h"
 
 struct token {
     enum class Type : std::uint8_t {
@@ -26,6 +31,7 @@ struct token {
         // Multiple character tokens
         IDENTIFIER,
         ID,
+        STRING,  // "..." lexeme holds the text between the quotes
 
         // Keywords
         BVAR,
@@ -39,6 +45,7 @@ struct token {
         // Special Keywords for functions
         TREE_DISPLAY,
         GRAPH_DISPLAY,
+        DAG_DISPLAY,
         IS_SAT,
         SOURCE,
 
@@ -46,6 +53,10 @@ struct token {
         EXISTS,
         FORALL,
 
+        // Special Keywords for n-ary operations
+        AND_ALL,
+        OR_ALL,
+
         // Special Keywords for memory management
         CLEAR_CACHE,
         PRESERVE,
@@ -53,21 +64,50 @@ struct token {
         PRESERVE_ALL,
         UNPRESERVE_ALL,
         SWEEP,
+
+        // Special Keywords for profiling
+        PROFILE_ON,
+        PROFILE_OFF,
+        PROFILE_REPORT,
+        PROFILE_CSV,
+
+        // Special Keywords for snapshots
+        SAVE,
+        LOAD,
+
+        // Special Keywords for importing problems from other formats
+        LOAD_CNF,
+        LOAD_AIGER,
+        LOAD_BLIF,
+        AS,
+
+        // Special Keywords for redirecting displays
+        TO,
+        LIMIT,
     };
 
     Type type;
-    std::string lexeme;                     // the text of the token
+    // The text of the token: interned for names and a string literal for
+    // keywords and punctuation. Strings and numbers are views into the source
+    // they were lexed from until Ast_Arena copies them into a literal.
+    std::string_view lexeme;
     std::optional<uint32_t> token_value{};  // optional value for number tokens
+    symbol_id symbol{};  // of the interned lexeme, for names
 
-    token(const Type type, const std::string& lexeme,
+    token(const Type type, const std::string_view lexeme,
           const std::optional<int> value = std::nullopt)
         : type(type), lexeme(lexeme), token_value(value) {
         assert(type != Type::ID || value.has_value());
+        if (type == Type::IDENTIFIER) {
+            const auto [id, name] = intern(lexeme);
+            this->lexeme = name;
+            symbol = id;
+        }
     }
 
     std::string repr() const {
         return "Token(" + std::to_string(static_cast<int>(type)) + ", " +
-               lexeme +
+               std::string(lexeme) +
                (token_value.has_value()
                     ? ", " + std::to_string(token_value.value())
                     : "") +
@@ -0,0 +1,94 @@
+#include "trace.h"
+
+#include <atomic>
+#include <format>
+
+static std::string json_escape(const std::string_view text) {
+    std::string result;
+    result.reserve(text.size());
+    for (const char c : text) {
+        switch (c) {
+            case '"':
+                result += "\\\"";
+                break;
+            case '\\':
+                result += "\\\\";
+                break;
+            case '\n':
+                result += "\\n";
+                break;
+            default:
+                // Other control characters are not allowed in JSON strings
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    result += std::format("\\u{:04x}",
+                                          static_cast<unsigned char>(c));
+                } else {
+                    result += c;
+                }
+        }
+    }
+    return result;
+}
+
+static uint32_t thread_index() {
+    // Small stable ids make the viewer's thread lanes readable
+    static std::atomic<uint32_t> next_index{1};
+    thread_local const uint32_t index = next_index++;
+    return index;
+}
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::~Tracer() { close(); }
+
+bool Tracer::open(const std::string& path) {
+    std::lock_guard lock(mutex);
+    if (file.is_open()) file.close();
+    file.open(path);
+    if (!file.is_open()) return false;
+
+    // The closing ']' is optional in the trace format, so a session that is
+    // killed part way through still produces a loadable trace
+    file << "[\n";
+    first_event = true;
+    origin = trace_clock::now();
+    return true;
+}
+
+void Tracer::close() {
+    std::lock_guard lock(mutex);
+    if (!file.is_open()) return;
+    file << "\n]\n";
+    file.close();
+}
+
+void Tracer::flush() {
+    std::lock_guard lock(mutex);
+    if (file.is_open()) file.flush();
+}
+
+void Tracer::record(const std::string_view name,
+                    const std::string_view category,
+                    const std::string_view detail,
+                    const trace_clock::time_point start,
+                    const trace_clock::time_point end) {
+    using us = std::chrono::duration<double, std::micro>;
+    std::lock_guard lock(mutex);
+    if (!file.is_open()) return;
+
+    if (!first_event) file << ",\n";
+    first_event = false;
+    file << std::format(R"({{"name":"{}","cat":"{}","ph":"X",)",
+                        json_escape(name), json_escape(category));
+    file << std::format(R"("ts":{:.3f},"dur":{:.3f},"pid":1,"tid":{})",
+                        us(start - origin).count(), us(end - start).count(),
+                        thread_index());
+    if (!detail.empty()) {
+        file << std::format(R"(,"args":{{"detail":"{}"}})",
+                            json_escape(detail));
+    }
+    file << '}';
+}
@@ -0,0 +1,74 @@
+#pragma once
+// Chrome trace event export, viewable in chrome://tracing or Perfetto.
+// Spans are only recorded when enable_tracing is set in config.h and a trace
+// file has been opened; otherwise Trace_Span compiles to nothing.
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "config.h"
+
+using trace_clock = std::chrono::steady_clock;
+
+class Tracer {
+    std::mutex mutex;
+    std::ofstream file;
+    bool first_event{true};
+    trace_clock::time_point origin{};
+
+    Tracer() = default;
+
+   public:
+    ~Tracer();
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    static Tracer& instance();
+
+    bool open(const std::string& path);  // starts a new trace file
+    void close();                        // terminates the JSON array
+    void flush();
+    bool is_open() const { return file.is_open(); }
+
+    // Records a complete ("X") event
+    void record(std::string_view name, std::string_view category,
+                std::string_view detail, trace_clock::time_point start,
+                trace_clock::time_point end);
+};
+
+// Scoped span, recorded as a complete event when it goes out of scope
+template <bool Enabled>
+class Basic_Trace_Span {
+    trace_clock::time_point start{trace_clock::now()};
+    std::string detail;
+    const char* name;
+    const char* category;
+
+   public:
+    Basic_Trace_Span(const char* name, const char* category)
+        : name(name), category(category) {}
+    ~Basic_Trace_Span() {
+        Tracer::instance().record(name, category, detail, start,
+                                  trace_clock::now());
+    }
+    Basic_Trace_Span(const Basic_Trace_Span&) = delete;
+    Basic_Trace_Span& operator=(const Basic_Trace_Span&) = delete;
+
+    // Attaches extra text shown in the event's args. Guard the call with
+    // `if constexpr (enable_tracing)` when building the text is expensive.
+    void annotate(std::string text) { detail = std::move(text); }
+};
+
+// Disabled spans hold nothing and do nothing
+template <>
+class Basic_Trace_Span<false> {
+   public:
+    Basic_Trace_Span(const char*, const char*) {}
+    Basic_Trace_Span(const Basic_Trace_Span&) = delete;
+    Basic_Trace_Span& operator=(const Basic_Trace_Span&) = delete;
+    void annotate(const std::string&) {}
+};
+
+using Trace_Span = Basic_Trace_Span<enable_tracing>;
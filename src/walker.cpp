@@ -2,6 +2,10 @@
 #include "walker.h"
 
 #include <fstream>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <ranges>
 
 #include "absl/log/log.h"
 #include "ast.h"
@@ -9,18 +13,10 @@
 #include "config.h"
 #include "engine_exceptions.h"
 #include "parser.h"
+#include "parse_pipeline.h"
+#include "trace.h"
 
-Walker::Walker() : counter(2) {
-    // Initialise the Walker
-    const Bdd_Node false_node{Bdd_Node::Bdd_type::FALSE, "false", 0, 0};
-    const Bdd_Node true_node{Bdd_Node::Bdd_type::TRUE, "true", 1, 1};
-    node_to_id[false_node] = 0;
-    node_to_id[true_node] = 1;
-    id_to_iter[0] = node_to_id.find(false_node);
-    id_to_iter[1] = node_to_id.find(true_node);
-    is_sat_memo[0] = false;
-    is_sat_memo[1] = true;
-}
+Walker::Walker() { reset_store(); }
 
 std::string Walker::get_output() {
     std::string output = out.str();
@@ -28,20 +24,91 @@ std::string Walker::get_output() {
     return output;
 }
 
-void Walker::walk_statements(const std::span<stmt>& statements) {
-    for (const auto& statement : statements) {
-        try {
-            if constexpr (print_ast) LOG(WARNING) << stmt_repr(statement);
+// File names may be given as identifiers (source file.bdd;) or as strings,
+// which also allow paths (save "out/relations.bddsnap";)
+static std::string file_name_of(const expr& arg, const token& func_name) {
+    if (const auto* id = std::get_if<identifier>(&arg)) {
+        return std::string(id->name.lexeme);
+    }
+    if (const auto* lit = std::get_if<literal>(&arg);
+        lit != nullptr && lit->value.type == token::Type::STRING) {
+        return std::string(lit->value.lexeme);
+    }
+    throw ExecutionException(std::string(func_name.lexeme) +
+                                 " expects a file name",
+                             "Walker::walk_func_call_stmt");
+}
+
+static std::string file_name_arg(const func_call_stmt& statement) {
+    if (statement.arguments.size() != 1) {
+        throw ExecutionException(
+            std::string(statement.func_name.lexeme) +
+                " expects a single file name",
+            "Walker::walk_func_call_stmt");
+    }
+    return file_name_of(*statement.arguments[0], statement.func_name);
+}
+
+// Imports are parsed as `load_x FILENAME as IDENTIFIER`
+static std::pair<std::string, std::string> import_args(
+    const func_call_stmt& statement) {
+    assert(statement.arguments.size() == 2);
+    const auto& target = std::get<identifier>(*statement.arguments[1]);
+    return {file_name_of(*statement.arguments[0], statement.func_name),
+            std::string(target.name.lexeme)};
+}
+
+static bool is_source_call(const stmt& statement) {
+    const auto* call = std::get_if<func_call_stmt>(&statement);
+    return call != nullptr && call->func_name.type == token::Type::SOURCE;
+}
+
+bool Walker::walk_statements(const std::span<stmt>& statements) {
+    // The caller frees the statements' arena once they have been walked
+    bool completed = true;
+    for (size_t i = 0; completed && i < statements.size();) {
+        if (const auto run = concurrent_run(statements.subspan(i));
+            run.size() > 1) {
+            completed = walk_concurrent(statements.subspan(i, run.size()), run);
+            i += run.size();
+        } else {
+            completed = walk_checked(statements[i]);
+            ++i;
+        }
+    }
+    expr_to_id_memo.clear();
+    return completed;
+}
+
+bool Walker::walk_checked(const stmt& statement) {
+    try {
+        if constexpr (print_ast) LOG(WARNING) << stmt_repr(statement);
+        Trace_Span span{"statement", "walker"};
+        if constexpr (enable_tracing) {
+            span.annotate(stmt_summary(statement));
+        }
+
+        // A source statement is only the sum of the statements it runs,
+        // which are profiled individually
+        if (profiling && !is_source_call(statement)) {
+            walk_profiled(statement);
+        } else {
             walk_raw(statement);
-        } catch (const ExecutionException& e) {
-            if constexpr (use_colours) set_colour(out, Colour::RED);
-            out << e.what() << '\n';
-            if constexpr (use_colours) set_colour(out);
-            return;
-        } catch (const std::exception& e) {
-            out << "Unhandled Execution Error: " << e.what() << '\n';
-            return;
         }
+    } catch (const std::exception& e) {
+        write_error(out, e);
+        return false;
+    }
+    return true;
+}
+
+void Walker::write_error(std::ostream& os, const std::exception& e) const {
+    if (dynamic_cast<const ExecutionException*>(&e) != nullptr) {
+        if (colours) set_colour(os, Colour::RED);
+        os << e.what() << '\n';
+        if (colours) set_colour(os);
+    } else {
+        os << "Unhandled Execution Error: " << e.what() << '\n';
     }
 }
 
@@ -49,13 +116,10 @@ void Walker::walk_single(const stmt& statement) {
     if constexpr (print_ast) LOG(WARNING) << stmt_repr(statement);
     try {
         walk_raw(statement);
-    } catch (const ExecutionException& e) {
-        if constexpr (use_colours) set_colour(out, Colour::RED);
-        out << e.what() << '\n';
-        if constexpr (use_colours) set_colour(out);
     } catch (const std::exception& e) {
-        out << "Unhandled Execution Error: " << e.what() << '\n';
+        write_error(out, e);
     }
+    expr_to_id_memo.clear();
 }
 
 void Walker::walk_raw(const stmt& statement) {
@@ -86,18 +150,60 @@ void Walker::walk_raw(const stmt& statement) {
         statement);
 }
 
+bool Walker::source_whole(std::istream& is) {
+    const std::string buffer{std::istreambuf_iterator(is), {}};
+    const lex_result_t tokens = [&] {
+        const Trace_Span span{"lex", "frontend"};
+        return scan_to_tokens(buffer);
+    }();
+    if (!tokens.has_value()) {
+        out << tokens.error().what() << '\n';
+        return false;
+    }
+    Ast_Arena arena;  // freed once the sourced file has been walked
+    parse_result_t estmts = [&] {
+        const Trace_Span span{"parse", "frontend"};
+        return parse(*tokens, arena);
+    }();
+    if (!estmts.has_value()) {
+        for (const auto& error : estmts.error()) {
+            out << error.what() << '\n';
+        }
+        return false;
+    }
+    return walk_statements(*estmts);
+}
+
+bool Walker::source_streaming(std::istream& is) {
+    // While profiling, a parser thread's allocations would be counted against
+    // whichever statement is running, so batches are parsed between them
+    Parse_Pipeline pipeline(is, !profiling);
+    while (auto batch = pipeline.next()) {
+        if (!walk_statements(batch->statements)) return false;
+        if (!batch->error.empty()) {
+            out << batch->error;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Walker::run_source(std::istream& is) {
+    return source_all_or_nothing ? source_whole(is) : source_streaming(is);
+}
+
 void Walker::walk_decl_stmt(const decl_stmt& statement) {
     // Handle declaration statement
     for (const auto& identifier : statement.identifiers) {
-        if (!globals.contains(identifier.lexeme)) {
-            auto new_var = Bvar_ptype{identifier.lexeme};
-            globals[identifier.lexeme] = new_var;
-            bdd_ordering_map[identifier.lexeme] = bdd_ordering.size();
+        if (const Ptype* value = globals.find(identifier.symbol);
+            value == nullptr) {
+            const auto level = static_cast<uint32_t>(bdd_ordering.size());
+            globals.bind(identifier.symbol,
+                         Bvar_ptype{identifier.lexeme, level});
             bdd_ordering.push_back(identifier.lexeme);
             out << "Declared Symbolic Variable: " << identifier.lexeme << '\n';
         } else {
-            if (std::holds_alternative<Bvar_ptype>(
-                    globals[identifier.lexeme])) {
+            if (std::holds_alternative<Bvar_ptype>(*value)) {
                 out << "Variable already declared: " << identifier.lexeme
                     << '\n';
             } else {
@@ -110,22 +216,54 @@ void Walker::walk_decl_stmt(const decl_stmt& statement) {
     }
 }
 
+uint32_t Walker::declare_var(const std::string_view name) {
+    const auto [symbol, interned] = intern(name);
+    if (const auto level = level_of(symbol)) return *level;
+    if (globals.contains(symbol)) {
+        throw ExecutionException(
+            "Variable name conflict (making a variable holding a bdd "
+            "symbolic): " + std::string(name),
+            __func__);
+    }
+    const auto level = static_cast<uint32_t>(bdd_ordering.size());
+    globals.bind(symbol, Bvar_ptype{interned, level});
+    bdd_ordering.push_back(interned);
+    return level;
+}
+
+void Walker::bind_bdd(const std::string_view name, const id_type id) {
+    const auto [symbol, interned] = intern(name);
+    if (const Ptype* value = globals.find(symbol);
+        value != nullptr && !std::holds_alternative<Bdd_ptype>(*value)) {
+        throw ExecutionException(
+            "Variable name conflict (assigning to symbolic variable): " +
+                std::string(name),
+            __func__);
+    } else if (value != nullptr) {
+        expr_to_id_memo.clear();  // nodes naming it may now differ
+    }
+    globals.bind(symbol, Bdd_ptype{interned, id});
+    out << "Assigned to " << name << " with BDD ID: " << id << '\n';
+}
+
 void Walker::walk_assign_stmt(const assign_stmt& statement) {
     // Handle assignment statement
-    if (globals.contains(statement.target->name.lexeme) &&
-        !std::holds_alternative<Bdd_ptype>(
-            globals[statement.target->name.lexeme])) {
+    const token& target = statement.target.name;
+    if (const Ptype* value = globals.find(target.symbol);
+        value != nullptr && !std::holds_alternative<Bdd_ptype>(*value)) {
         out << "Variable name conflict (assigning to symbolic variable), "
                "ignoring assignment of: "
-            << statement.target->name.lexeme << '\n';
+            << target.lexeme << '\n';
         return;
     }
 
     const id_type bdd_id = construct_bdd(*statement.value);
-    globals[statement.target->name.lexeme] =
-        Bdd_ptype{statement.target->name.lexeme, bdd_id};
-    out << "Assigned to " << statement.target->name.lexeme
-        << " with BDD ID: " << bdd_id << '\n';
+    if (globals.contains(target.symbol)) {
+        expr_to_id_memo.clear();  // nodes naming the target may now differ
+    }
+    globals.bind(target.symbol, Bdd_ptype{target.lexeme, bdd_id});
+    out << "Assigned to " << target.lexeme << " with BDD ID: " << bdd_id
+        << '\n';
 }
 
 void Walker::walk_func_call_stmt(const func_call_stmt& statement) {
@@ -141,15 +279,54 @@ void Walker::walk_func_call_stmt(const func_call_stmt& statement) {
             out << bdd_repr(bdd_id) << '\n';
             break;
         }
-        case token::Type::GRAPH_DISPLAY: {
-            if (statement.arguments.size() != 1) {
+        case token::Type::GRAPH_DISPLAY:
+        case token::Type::DAG_DISPLAY: {
+            if (statement.arguments.empty()) {
                 throw ExecutionException(
-                    "Invalid number of arguments for graph display", __func__);
+                    "Invalid number of arguments for display", __func__);
             }
+            const id_type bdd_id = construct_bdd(*statement.arguments[0]);
+            const bool dag =
+                statement.func_name.type == token::Type::DAG_DISPLAY;
 
-            id_type bdd_id = construct_bdd(*statement.arguments[0]);
-            std::string gviz_rep = bdd_gviz_repr(bdd_id);
-            out << gviz_rep << '\n';
+            // Parsed as `display_x expr (to FILENAME)? (limit ID)?`
+            std::optional<std::string> filename;
+            size_t node_limit = std::numeric_limits<size_t>::max();
+            for (const auto& arg : statement.arguments | std::views::drop(1)) {
+                if (const auto* lit = std::get_if<literal>(&*arg);
+                    lit != nullptr && lit->value.type == token::Type::ID) {
+                    node_limit = *lit->value.token_value;
+                } else {
+                    filename = file_name_of(*arg, statement.func_name);
+                }
+            }
+            const auto write = [&](std::ostream& os) {
+                return dag ? write_dag(os, bdd_id, node_limit)
+                           : write_gviz(os, bdd_id, node_limit);
+            };
+            if (!filename) {
+                write(out);
+                break;
+            }
+
+            // A large buffer keeps the writes to the file few and large
+            std::vector<char> buffer(1 << 20);
+            std::ofstream f;
+            f.rdbuf()->pubsetbuf(buffer.data(),
+                                 static_cast<std::streamsize>(buffer.size()));
+            f.open(*filename);
+            if (!f.is_open()) {
+                throw ExecutionException("Failed to open file: " + *filename,
+                                         __func__);
+            }
+            const size_t written = write(f);
+            f.close();
+            if (f.fail()) {
+                throw ExecutionException("Failed to write file: " + *filename,
+                                         __func__);
+            }
+            out << "Wrote " << (dag ? "DAG" : "graph") << " of " << written
+                << " nodes to " << *filename << '\n';
             break;
         }
         case token::Type::IS_SAT: {
@@ -173,51 +350,19 @@ void Walker::walk_func_call_stmt(const func_call_stmt& statement) {
             }
             LOG(INFO) << "Source Function Called" << '\n';
 
-            if (!std::holds_alternative<identifier>(*statement.arguments[0])) {
-                throw ExecutionException("Invalid argument type for source",
-                                         __func__);
-            }
-
-            auto filename =
-                std::get<identifier>(*statement.arguments[0]).name.lexeme;
-
-            // Read all the file into the buffer
-            std::string buffer;
-            std::ifstream f(filename);
+            const std::string filename = file_name_arg(statement);
+            std::ifstream f(filename, std::ios::binary);
             if (!f.is_open()) {
                 out << "Failed to open file: " << filename;
                 return;
             }
-            f.seekg(0, std::ios::end);
-            buffer.resize(f.tellg());
-            f.seekg(0);
-            f.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
-            f.close();
-
-            if (f.fail()) {
-                out << "Failed to read file: " << filename;
-                return;
-            }
-
-            if (buffer.empty()) {
+            if (f.peek() == std::ifstream::traits_type::eof()) {
                 out << "File is empty: " << filename;
                 return;
             }
 
-            lex_result_t tokens = scan_to_tokens(buffer);
-            if (!tokens.has_value()) {
-                out << tokens.error().what() << '\n';
-                return;
-            }
-            parse_result_t estmts = parse(*tokens);
-            if (!estmts.has_value()) {
-                for (const auto& error : estmts.error()) {
-                    out << error.what() << '\n';
-                }
-                return;
-            }
-
-            walk_statements(*estmts);
+            run_source(f);
+            if (f.bad()) out << "Failed to read file: " << filename;
             break;
         }
         case token::Type::CLEAR_CACHE: {
@@ -231,25 +376,25 @@ void Walker::walk_func_call_stmt(const func_call_stmt& statement) {
                     throw ExecutionException(
                         "Invalid argument type for preserve", __func__);
                 }
-                if (const auto& id = std::get<identifier>(*arg).name.lexeme;
-                    globals.contains(id)) {
-                    if (std::holds_alternative<Bdd_ptype>(globals[id])) {
-                        std::get<Bdd_ptype>(globals[id]).preserved = true;
-                        out << "Preserved BDD: " << id << '\n';
+                const token& name = std::get<identifier>(*arg).name;
+                if (Ptype* value = globals.find(name.symbol)) {
+                    if (auto* bdd = std::get_if<Bdd_ptype>(value)) {
+                        bdd->preserved = true;
+                        out << "Preserved BDD: " << name.lexeme << '\n';
                     } else {
-                        out << "Variable is not a BDD: " << id << '\n';
+                        out << "Variable is not a BDD: " << name.lexeme << '\n';
                     }
                 } else {
-                    out << "Variable not found: " << id << '\n';
+                    out << "Variable not found: " << name.lexeme << '\n';
                 }
             }
             break;
         }
         case token::Type::PRESERVE_ALL: {
-            for (auto& [name, value] : globals) {
-                if (std::holds_alternative<Bdd_ptype>(value)) {
-                    std::get<Bdd_ptype>(value).preserved = true;
-                    out << "Preserved BDD: " << name << '\n';
+            for (auto& value : globals.values()) {
+                if (auto* bdd = std::get_if<Bdd_ptype>(&value)) {
+                    bdd->preserved = true;
+                    out << "Preserved BDD: " << bdd->name << '\n';
                 }
             }
             break;
@@ -260,25 +405,25 @@ void Walker::walk_func_call_stmt(const func_call_stmt& statement) {
                     throw ExecutionException(
                         "Invalid argument type for unpreserve", __func__);
                 }
-                if (const auto& id = std::get<identifier>(*arg).name.lexeme;
-                    globals.contains(id)) {
-                    if (std::holds_alternative<Bdd_ptype>(globals[id])) {
-                        std::get<Bdd_ptype>(globals[id]).preserved = false;
-                        out << "Unpreserved BDD: " << id << '\n';
+                const token& name = std::get<identifier>(*arg).name;
+                if (Ptype* value = globals.find(name.symbol)) {
+                    if (auto* bdd = std::get_if<Bdd_ptype>(value)) {
+                        bdd->preserved = false;
+                        out << "Unpreserved BDD: " << name.lexeme << '\n';
                     } else {
-                        out << "Variable is not a BDD: " << id << '\n';
+                        out << "Variable is not a BDD: " << name.lexeme << '\n';
                     }
                 } else {
-                    out << "Variable not found: " << id << '\n';
+                    out << "Variable not found: " << name.lexeme << '\n';
                 }
             }
             break;
         }
         case token::Type::UNPRESERVE_ALL: {
-            for (auto& [name, value] : globals) {
-                if (std::holds_alternative<Bdd_ptype>(value)) {
-                    std::get<Bdd_ptype>(value).preserved = false;
-                    out << "Unpreserved BDD: " << name << '\n';
+            for (auto& value : globals.values()) {
+                if (auto* bdd = std::get_if<Bdd_ptype>(&value)) {
+                    bdd->preserved = false;
+                    out << "Unpreserved BDD: " << bdd->name << '\n';
                 }
             }
             break;
@@ -288,6 +433,67 @@ void Walker::walk_func_call_stmt(const func_call_stmt& statement) {
             out << "Swept all non-preserved BDDs" << '\n';
             break;
         }
+        case token::Type::PROFILE_ON: {
+            set_profiling(true);
+            out << "Profiling enabled" << '\n';
+            break;
+        }
+        case token::Type::PROFILE_OFF: {
+            set_profiling(false);
+            out << "Profiling disabled" << '\n';
+            break;
+        }
+        case token::Type::PROFILE_REPORT: {
+            size_t top_n = default_profile_top_n;
+            if (statement.arguments.size() > 1) {
+                throw ExecutionException(
+                    "Invalid number of arguments for profile_report", __func__);
+            }
+            if (statement.arguments.size() == 1) {
+                const auto* lit =
+                    std::get_if<literal>(&*statement.arguments[0]);
+                if (lit == nullptr || lit->value.type != token::Type::ID) {
+                    throw ExecutionException(
+                        "profile_report expects a number of statements",
+                        __func__);
+                }
+                top_n = *lit->value.token_value;
+            }
+            write_profile_report(out, top_n);
+            break;
+        }
+        case token::Type::PROFILE_CSV: {
+            const std::string filename = file_name_arg(statement);
+            std::ofstream f(filename);
+            if (!f.is_open()) {
+                out << "Failed to open file: " << filename << '\n';
+                return;
+            }
+            write_profile_csv(f);
+            out << "Wrote profile of " << profile.size()
+                << " statements to " << filename << '\n';
+            break;
+        }
+        case token::Type::SAVE: {
+            save_snapshot(file_name_arg(statement));
+            break;
+        }
+        case token::Type::LOAD: {
+            load_snapshot(file_name_arg(statement));
+            break;
+        }
+        case token::Type::LOAD_CNF: {
+            const auto& [path, target] = import_args(statement);
+            import_cnf(path, target);
+            break;
+        }
+        case token::Type::LOAD_AIGER:
+        case token::Type::LOAD_BLIF: {
+            const auto& [path, target] = import_args(statement);
+            import_circuit(path, target,
+                           statement.func_name.type == token::Type::LOAD_BLIF);
+            break;
+        }
         default:
             throw ExecutionException("Unknown function call", __func__);
     }
@@ -1,13 +1,29 @@
 #pragma once
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <ranges>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/hash/hash.h"
 #include "ast.h"
+#include "bytecode.h"
+#include "schedule.h"
 
 // Runtime BDD Structure
 using id_type = uint32_t;
+constexpr uint32_t terminal_level = UINT32_MAX;  // below every variable
+
+// Plain 16 byte record, so that snapshots can store nodes as they are in
+// memory and a mapped snapshot can be used without conversion
 struct Bdd_Node {
     enum class Bdd_type : std::uint8_t {
         TRUE,
@@ -16,7 +32,7 @@ struct Bdd_Node {
     };
 
     Bdd_type type{};
-    std::string var{};  // variable name if internal
+    uint32_t var{};  // index of the variable in bdd_ordering if internal
     id_type high;
     id_type low;  // only used for internal nodes
 
@@ -29,21 +45,35 @@ struct Bdd_Node {
         return H::combine(std::move(h), node.var, node.high, node.low);
     }
 };
+static_assert(std::is_trivially_copyable_v<Bdd_Node> &&
+              sizeof(Bdd_Node) == 16);
 
 // Binary operation types for the memo table
 enum class BinOpType : std::uint8_t { AND, OR };
 
+// Order in which the operands of a conjunction or disjunction of more than
+// two BDDs are combined (see Walker::apply_all)
+enum class Nary_Schedule : std::uint8_t {
+    IN_ORDER,        // left to right, as written
+    SMALLEST_FIRST,  // the two smallest BDDs, partial results by estimate
+    BALANCED,        // neighbours pairwise, halving the operands each round
+};
+// "in_order", "smallest" or "balanced"
+std::optional<Nary_Schedule> parse_nary_schedule(std::string_view name);
+
 // Variable Types
 // Each variable is either a BDD symbol or a variable that represents a binary
 // decision diagram
+// Names are interned (see symbol_table.h)
 struct Bvar_ptype {
     // Binary variable type
-    std::string name{};
+    std::string_view name{};
+    uint32_t level{};  // index of the variable in bdd_ordering
 };
 
 struct Bdd_ptype {
     // Expression type
-    std::string name{};
+    std::string_view name{};
     id_type id{};
     bool preserved{};
 };
@@ -51,29 +81,191 @@ struct Bdd_ptype {
 using Ptype = std::variant<Bvar_ptype, Bdd_ptype>;
 enum class Ptype_type : std::uint8_t { BVAR = 0, BDD = 1 };
 
+// The bindings of a session. Each name gets a dense slot the first time the
+// walker binds it, so the slots only grow with the names this walker has
+// used, whatever else the process-wide symbol table holds, and iterating
+// them visits the names in the order they were first bound.
+class Environment {
+    absl::flat_hash_map<symbol_id, uint32_t> slot_of;
+    std::vector<std::optional<Ptype>> slots;
+    size_t bound{};
+
+    template <typename Slots>
+    static auto values_of(Slots& slots) {
+        return slots |
+               std::views::filter([](const auto& s) { return s.has_value(); }) |
+               std::views::transform([](auto& s) -> auto& { return *s; });
+    }
+
+   public:
+    const Ptype* find(const symbol_id symbol) const {
+        const auto it = slot_of.find(symbol);
+        if (it == slot_of.end() || !slots[it->second].has_value()) {
+            return nullptr;
+        }
+        return &*slots[it->second];
+    }
+    Ptype* find(const symbol_id symbol) {
+        return const_cast<Ptype*>(std::as_const(*this).find(symbol));
+    }
+    bool contains(const symbol_id symbol) const {
+        return find(symbol) != nullptr;
+    }
+
+    // Binds symbol to value, replacing any previous value
+    void bind(const symbol_id symbol, Ptype value) {
+        const auto [it, inserted] =
+            slot_of.try_emplace(symbol, static_cast<uint32_t>(slots.size()));
+        if (inserted) slots.emplace_back();
+        std::optional<Ptype>& slot = slots[it->second];
+        if (!slot.has_value()) ++bound;
+        slot = std::move(value);
+    }
+    void erase(const symbol_id symbol) {
+        if (const auto it = slot_of.find(symbol);
+            it != slot_of.end() && slots[it->second].has_value()) {
+            slots[it->second].reset();
+            --bound;
+        }
+    }
+    template <typename Pred>
+    void erase_if(Pred pred) {
+        for (auto& slot : slots) {
+            if (slot.has_value() && pred(std::as_const(*slot))) {
+                slot.reset();
+                --bound;
+            }
+        }
+    }
+    void clear() {
+        slot_of.clear();
+        slots.clear();
+        bound = 0;
+    }
+    size_t size() const { return bound; }
+
+    // The bound values in the order their names were first bound
+    auto values() { return values_of(slots); }
+    auto values() const { return values_of(slots); }
+};
+
+// Counters maintained by the BDD kernels, sampled around each statement when
+// profiling is enabled
+struct Walker_Stats {
+    uint64_t cache_hits{};    // apply/quantifier memo lookups that hit
+    uint64_t cache_misses{};  // apply/quantifier memo lookups that missed
+    uint32_t depth{};         // current recursion depth of the kernels
+    uint32_t peak_depth{};    // deepest recursion since the last reset
+};
+
+// Increments the kernel recursion depth for the lifetime of the guard
+class Depth_Guard {
+    Walker_Stats& stats;
+
+   public:
+    explicit Depth_Guard(Walker_Stats& s) : stats(s) {
+        if (++stats.depth > stats.peak_depth) stats.peak_depth = stats.depth;
+    }
+    ~Depth_Guard() { --stats.depth; }
+    Depth_Guard(const Depth_Guard&) = delete;
+    Depth_Guard& operator=(const Depth_Guard&) = delete;
+};
+
+// Per-statement measurements recorded while profiling
+struct Stmt_Profile {
+    size_t index{};     // position in execution order since profiling began
+    std::string label;  // from stmt_summary
+    std::chrono::nanoseconds wall_time{};
+    id_type nodes_created{};
+    uint64_t cache_hits{};
+    uint64_t cache_misses{};
+    uint32_t peak_depth{};
+    uint64_t allocations{};      // heap counts, zero unless alloc_stats is
+    uint64_t allocated_bytes{};  // hooked (see alloc_stats.h)
+    int64_t peak_heap_bytes{};   // high-water mark above the starting heap
+};
+
 // Walker Types to hold BDDs
 using node_id_map = std::unordered_map<Bdd_Node, id_type, absl::Hash<Bdd_Node>>;
 using iter_type = node_id_map::iterator;
 using id_iter_map =
     std::unordered_map<id_type, iter_type>;  // human_ids -> iter
+
+class Mapped_Snapshot;  // read-only base layer, see snapshot.h
+
 class Walker {
     // An instance of the tree-walk interpreter
     // Manages the environment of the interpreter and available BDDs in the
     // memory Side-effect-free, output is written to this->out stream
     friend class InterpTester;
+    friend class Manager;  // the library API of bdd.h
+    friend class Bdd;
 
     std::ostringstream out;  // printable output
     id_type counter{};       // monotonically increasing human indices
     id_iter_map id_to_iter;
     node_id_map node_to_id;  // main map that holds the BDD nodes
 
-    iter_type iter_to_false;
-    iter_type iter_to_true;
+    // Ids below base_size index a read-only array instead of the maps: just
+    // the terminals, or a memory-mapped snapshot whose nodes are never swept
+    std::shared_ptr<const Mapped_Snapshot> base;
+    const Bdd_Node* base_nodes{};
+    id_type base_size{};
+    uint32_t base_vars{};  // variables of the snapshot
 
-    std::unordered_map<std::string, Ptype> globals;
+    // A worker evaluates assignments for a parent that does not change
+    // meanwhile (see walk_concurrent): it reads the parent's nodes and
+    // bindings, and the nodes it creates get ids from parent_limit up in its
+    // own maps until the parent adopts them
+    const Walker* parent{};
+    id_type parent_limit{};  // the parent's counter when the worker was made
+    explicit Walker(const Walker* parent_walker);
 
-    std::vector<std::string> bdd_ordering;  // for BDD ordering
-    std::unordered_map<std::string, uint32_t> bdd_ordering_map;
+    const Bdd_Node& node_of(const id_type id) const {
+        if (id < base_size) return base_node(id);
+        if (id < parent_limit) return parent->node_of(id);
+        return id_to_iter.find(id)->second->first;
+    }
+    // A mapped node is checked whenever it is read rather than all at once
+    // when mapping, which would page in the whole file. Ids and levels in
+    // bounds, with children below their parent, are all that reading the
+    // nodes relies on.
+    const Bdd_Node& base_node(const id_type id) const {
+        const Bdd_Node& node = base_nodes[id];
+        if (id >= 2 && (node.type != Bdd_Node::Bdd_type::INTERNAL ||
+                        node.var >= base_vars || node.high >= id ||
+                        node.low >= id || node.high == node.low))
+            [[unlikely]] {
+            throw_malformed_node(id);
+        }
+        return node;
+    }
+    [[noreturn]] static void throw_malformed_node(id_type id);
+    bool has_node(const id_type id) const {
+        if (id < base_size) return true;
+        if (id < parent_limit) return parent->has_node(id);
+        return id_to_iter.contains(id);
+    }
+
+    Environment globals;
+    const Ptype* find_global(const symbol_id symbol) const {
+        return (parent != nullptr ? parent->globals : globals).find(symbol);
+    }
+    // Level of the symbolic variable named by symbol, if it is one
+    std::optional<uint32_t> level_of(const symbol_id symbol) const {
+        const Ptype* value = find_global(symbol);
+        const auto* var = value ? std::get_if<Bvar_ptype>(value) : nullptr;
+        return var ? std::optional(var->level) : std::nullopt;
+    }
+
+    std::vector<std::string_view> bdd_ordering;  // interned, for BDD ordering
+
+    // === Profiling ===
+    Walker_Stats stats;
+    bool profiling{};
+    size_t profiled_count{};  // statements seen since profiling began
+    std::vector<Stmt_Profile> profile;
+    void walk_profiled(const stmt& statement);  // walk_raw + record
 
     // === Walking Statements ===
     void walk_raw(const stmt& statement);  // May throw execution exceptions,
@@ -82,9 +274,60 @@ class Walker {
     void walk_assign_stmt(const assign_stmt& statement);
     void walk_func_call_stmt(const func_call_stmt& statement);
     void walk_expr_stmt(const expr_stmt& statement);
+    bool walk_checked(const stmt& statement);  // false if it threw
+    // Writes the message for an exception that stopped a statement
+    void write_error(std::ostream& os, const std::exception& e) const;
+    bool colours{true};  // of error messages, see set_colours
+
+    // === Concurrent Assignments ===
+    // Independent assignments run on up to statement_threads workers, with
+    // output and bindings still in program order
+    size_t statement_threads{1};
+    // Accesses of the assignments at the start of statements that can be
+    // scheduled together, empty when running concurrently is disabled
+    std::vector<Stmt_Access> concurrent_run(
+        std::span<const stmt> statements) const;
+    bool walk_concurrent(std::span<const stmt> statements,
+                         std::span<const Stmt_Access> accesses);
+    // Copies the nodes of a worker's BDD into this store, children first,
+    // and returns its id here
+    id_type adopt(const Walker& worker, id_type id);
+
+    // Scripts for `source` (see run_source)
+    bool source_all_or_nothing{};
+    bool source_whole(std::istream& is);  // false if anything failed
+    bool source_streaming(std::istream& is);
+
+    // Declares name as a symbolic variable unless it already is one, and
+    // returns its level. Throws if name holds a BDD.
+    uint32_t declare_var(std::string_view name);
+    // Binds name to a BDD like `set`. Throws if name is a symbolic variable.
+    void bind_bdd(std::string_view name, id_type id);
 
     // === BDD Construction ===
+    // Evaluates x by lowering it to bytecode and running that
     id_type construct_bdd(const expr& x);
+    // Replaces program with x lowered, resolving names in the current session
+    void lower(const expr& x, Bytecode& program);
+    id_type execute(const Bytecode& program, std::vector<id_type>& regs);
+    id_type substitute(const sub_expr& expression);
+
+    // A program and its registers for each level of nested substitution, and
+    // the register of each node while lowering. All are reused, so once they
+    // have grown to fit, evaluating an expression allocates nothing.
+    struct Program_Frame {
+        Bytecode program;
+        std::vector<id_type> regs;
+    };
+    std::deque<Program_Frame> program_frames;  // stable under push_back
+    size_t program_depth{};
+    absl::flat_hash_map<const expr*, uint32_t> lowered_regs;
+
+    // BDD of each expression node evaluated in the current batch, so that a
+    // node shared within or across statements is evaluated once. Keyed by
+    // address, so cleared before the nodes' arena is freed, and whenever a
+    // name is rebound or swept.
+    std::unordered_map<const expr*, id_type> expr_to_id_memo;
     id_type get_id(const Bdd_Node& node);
 
     std::unordered_map<std::tuple<id_type, id_type, BinOpType>, id_type,
@@ -96,31 +339,45 @@ class Walker {
     std::map<id_type, id_type> not_memo;  // (reusable)
     id_type rec_apply_not(id_type a);
 
+    // Conjunction or disjunction of many BDDs, combined in the order of the
+    // schedule and stopping as soon as a partial result is false for a
+    // conjunction or true for a disjunction
+    id_type apply_all(BinOpType op, std::vector<id_type> operands,
+                      Nary_Schedule schedule);
+    Nary_Schedule nary_schedule{Nary_Schedule::IN_ORDER};
+
     std::unordered_map<std::tuple<id_type, size_t>, id_type,
                        absl::Hash<std::tuple<id_type, size_t>>>
         quantifier_memo;  // (unreusable)
 
     template <typename Comb_Fn_Type>
-    id_type rec_apply_quant(id_type a, std::span<std::string> bound_vars,
-                            Comb_Fn_Type comb_fn);
+    id_type rec_apply_quant(id_type a, std::span<const uint32_t> bound_vars,
+                            Comb_Fn_Type comb_fn);  // bound_vars are levels
+    // Quantifies the variables at the given levels out of a
+    id_type quantify(id_type a, std::vector<uint32_t> levels, bool exists);
+
+    // a with the variable at level fixed to value
+    id_type rec_restrict(id_type a, uint32_t level, bool value,
+                         std::unordered_map<id_type, id_type>& memo);
+    // a with the variable at level replaced by g
+    id_type compose(id_type a, uint32_t level, id_type g);
 
     // ==== Substitution ====
     // Convert BDDs back to Expressions for Substitution
-    std::shared_ptr<expr> false_expr{
-        std::make_shared<expr>(literal{token{token::Type::FALSE, "false"}})};
-    std::shared_ptr<expr> true_expr{
-        std::make_shared<expr>(literal{token{token::Type::TRUE, "true"}})};
+    const expr false_expr{literal{token{token::Type::FALSE, "false"}}};
+    const expr true_expr{literal{token{token::Type::TRUE, "true"}}};
 
-    // Reconstruct expr from bdd id
-    std::shared_ptr<expr> construct_expr(id_type id);
-    // Cache expr reconstructions (reusable)
-    std::unordered_map<id_type, std::shared_ptr<expr>> id_to_expr_memo;
+    // Reconstruct expr from bdd id, built into expr_arena
+    const expr* construct_expr(id_type id);
+    // Cache expr reconstructions (reusable), freed with the arena
+    Ast_Arena expr_arena;
+    std::unordered_map<id_type, const expr*> id_to_expr_memo;
 
     // Cache substituted expressions for specific substitutions (unreusable)
-    std::unordered_map<std::shared_ptr<expr>, std::shared_ptr<expr>> sub_memo;
-    std::shared_ptr<expr> substitute_expr(
-        const std::shared_ptr<expr>& x,
-        const substitution_map& sub_map);  // substitute variables in expr
+    std::unordered_map<const expr*, const expr*> sub_memo;
+    // substitute variables in expr, building new nodes into arena
+    const expr* substitute_expr(const expr* x, const substitution_map& sub_map,
+                                Ast_Arena& arena);
 
     // === BDD Viewing ===
     // check if BDD is satisfiable
@@ -128,18 +385,81 @@ class Walker {
     bool is_sat(id_type a);
 
     std::unordered_set<id_type> get_bdd_nodes(id_type id);
+    size_t bdd_size(id_type id);  // number of reachable nodes
+    double sat_count(id_type a);  // over every declared variable
     std::string bdd_repr(id_type id);
-    std::string bdd_gviz_repr(id_type id);
+    // Returns the number of nodes written, at most node_limit
+    size_t write_gviz(std::ostream& os, id_type id, size_t node_limit);
+    size_t write_dag(std::ostream& os, id_type id, size_t node_limit);
 
     // === Memory Management ===
     void clear_memos();
     void sweep(); // sweep non-preserved BDDs from memory
+    void reset_store();  // drop every node, binding and memo but the terminals
+    size_t peak_nodes{};  // highest live node count seen by a sweep or reset
+
+    // === Importing ===
+    void import_cnf(const std::string& path, const std::string& target);
+    // Binds each output of the netlist to target.<output name>
+    void import_circuit(const std::string& path, const std::string& target,
+                        bool blif);
+
+    // === Snapshots ===
+    void save_snapshot(const std::string& path);
+    void load_snapshot(const std::string& path);  // replaces the session state
 
    public:
     Walker();
     void walk_single(const stmt& statement);  // Walk AST, handles exceptions
-    void walk_statements(
-        const std::span<stmt>& statements);  // Returns early on exceptions
+    // Returns early on exceptions, and false if it did
+    bool walk_statements(const std::span<stmt>& statements);
     std::string
     get_output();  // clears the output buffer and returns the output
+
+    // Profiling: records one Stmt_Profile per statement in walk_statements
+    void set_profiling(bool enabled);  // enabling clears previous records
+    const std::vector<Stmt_Profile>& get_profile() const { return profile; }
+    void write_profile_report(std::ostream& os, size_t top_n) const;
+    void write_profile_csv(std::ostream& os) const;
+
+    // Runs a script like `source`. By default statements are parsed on a
+    // background thread in batches of Parse_Pipeline::batch_statements, and
+    // each batch runs once it has been parsed, stopping at the first error;
+    // in all-or-nothing mode the whole script is parsed first and nothing
+    // runs if any of it is invalid. Returns false if the script stopped on
+    // an error.
+    bool run_source(std::istream& is);
+    void set_source_all_or_nothing(const bool enabled) {
+        source_all_or_nothing = enabled;
+    }
+
+    // Runs independent assignments of a batch on up to n threads (1 runs
+    // every statement in order). Node ids then depend on the schedule but not
+    // on timing, so output is the same from run to run. Ignored while
+    // profiling.
+    void set_statement_threads(const size_t n) {
+        statement_threads = std::max<size_t>(n, 1);
+    }
+
+    // Colours error messages (when enabled in config.h); turn it off when
+    // the output does not go to a terminal
+    void set_colours(const bool enabled) { colours = enabled; }
+
+    // How and_all, or_all and chains of & or | combine their operands
+    void set_nary_schedule(const Nary_Schedule schedule) {
+        nary_schedule = schedule;
+    }
+
+    // Replaces the session with a memory-mapped snapshot as a read-only base
+    // layer; new nodes go into the maps. Throws ExecutionException.
+    void map_snapshot(const std::string& path);
+
+    // Engine totals for benchmarks
+    const Walker_Stats& get_stats() const { return stats; }
+    id_type get_nodes_created() const { return counter - base_size; }
+    size_t get_live_nodes() const { return base_size + id_to_iter.size(); }
+    // Most nodes alive at once, including any base layer
+    size_t get_peak_nodes() const {
+        return std::max(peak_nodes, get_live_nodes());
+    }
 };
@@ -1,150 +1,75 @@
+#include <algorithm>
 #include <cassert>
+#include <optional>
+#include <queue>
 #include <ranges>
-#include <variant>
+#include <string_view>
+#include <utility>
+#include <vector>
 
-#include "engine_exceptions.h"
+#include "snapshot.h"
+#include "trace.h"
 #include "walker.h"
 
 id_type Walker::construct_bdd(const expr& x) {
-    id_type ret_id{};
-    std::visit(
-        [&ret_id, this]<typename T0>(const T0& expression) {
-            using T = std::remove_cvref_t<T0>;
-
-            if constexpr (std::is_same_v<T, sub_expr>) {
-                // Handle substitution expression
-                substitution_map sub_map = expression.substitutions;
-                auto body_bdd = construct_bdd(*expression.body);
-                auto reconstructed_expr = construct_expr(body_bdd);
-                auto substituted_expr =
-                    substitute_expr(reconstructed_expr, sub_map);
-                sub_memo.clear();  // sub memo is for specific substitutions
-                auto subbed_body = construct_bdd(*substituted_expr);
-                return ret_id = subbed_body;
-            } else if constexpr (std::is_same_v<T, bin_expr>) {
-                const id_type left_bdd = construct_bdd(*expression.left);
-                const id_type right_bdd = construct_bdd(*expression.right);
-                id_type combined_bdd = 0;
-
-                if (expression.op.type == token::Type::LAND) {
-                    combined_bdd = rec_apply_and(left_bdd, right_bdd);
-                } else if (expression.op.type == token::Type::LOR) {
-                    combined_bdd = rec_apply_or(left_bdd, right_bdd);
-                } else {
-                    throw std::runtime_error("Unsupported binary operator" +
-                                             expression.op.lexeme);
-                }
-                return ret_id = combined_bdd;
-            } else if constexpr (std::is_same_v<T, quantifier_expr>) {
-                // Handle quantifier expression
-                id_type body_bdd = construct_bdd(*expression.body);
-
-                // Simple Cases
-                if (body_bdd == 0 || body_bdd == 1) {
-                    return ret_id = body_bdd;
-                }
-                const Bdd_Node& body_bdd_node = id_to_iter[body_bdd]->first;
-                assert(body_bdd_node.type == Bdd_Node::Bdd_type::INTERNAL);
-
-                // Ensure that the bound variables at least as high in
-                // bdd_ordering as the top node of the body, Sort the bound
-                // variables in the order of their appearance in bdd_ordering
-                auto vw =
-                    expression.bound_vars |
-                    std::views::transform(
-                        [](const auto& id) { return id.lexeme; }) |
-                    std::views::filter([this, &body_bdd_node](const auto& id) {
-                        return bdd_ordering_map[id] >=
-                               bdd_ordering_map[body_bdd_node.var];
-                    });
-                std::vector<std::string> bound_var_names(vw.begin(), vw.end());
-                std::ranges::sort(
-                    bound_var_names, [this](const auto& a, const auto& b) {
-                        return bdd_ordering_map[a] < bdd_ordering_map[b];
-                    });
-
-                // Clear the quantifier memo but binary operation memos can be
-                // kept
-                quantifier_memo.clear();
-
-                // Apply the quantifier
-                if (expression.quantifier.type == token::Type::EXISTS) {
-                    return ret_id = rec_apply_quant(
-                               body_bdd, bound_var_names,
-                               [this](const id_type a, const id_type b) {
-                                   return rec_apply_or(a, b);
-                               });
-                } else if (expression.quantifier.type == token::Type::FORALL) {
-                    return ret_id = rec_apply_quant(
-                               body_bdd, bound_var_names,
-                               [this](const id_type a, const id_type b) {
-                                   return rec_apply_and(a, b);
-                               });
-
-                } else {
-                    throw std::runtime_error("Unsupported quantifier type");
-                }
-            } else if constexpr (std::is_same_v<T, unary_expr>) {
-                // Handle unary expression
-                const id_type operand_bdd = construct_bdd(*expression.operand);
-                if (expression.op.type == token::Type::BANG) {
-                    return ret_id = rec_apply_not(operand_bdd);
-                } else {
-                    throw std::runtime_error("Unsupported unary operator");
-                }
-
-            } else if constexpr (std::is_same_v<T, literal>) {
-                // Handle literal
-                if (expression.value.type == token::Type::ID) {
-                    if (id_to_iter.contains(*expression.value.token_value)) {
-                        return ret_id = *expression.value.token_value;
-                    } else {
-                        throw ExecutionException(
-                            "ID not found: " + expression.value.lexeme,
-                            "Walker::construct_bdd");
-                    }
-                } else if (expression.value.type == token::Type::TRUE) {
-                    return ret_id = static_cast<id_type>(1);
-                } else if (expression.value.type == token::Type::FALSE) {
-                    return ret_id = static_cast<id_type>(0);
-                } else {
-                    throw std::runtime_error("Unsupported literal type");
-                }
-            } else if constexpr (std::is_same_v<T, identifier>) {
-                // Handle identifier
-                if (globals.contains(expression.name.lexeme)) {
-                    if (std::holds_alternative<Bvar_ptype>(
-                            globals[expression.name.lexeme])) {
-                        // Handle BDD variable
-                        const auto& bvar = std::get<Bvar_ptype>(
-                            globals[expression.name.lexeme]);
-                        const Bdd_Node bdd_node{Bdd_Node::Bdd_type::INTERNAL,
-                                                bvar.name, 1,
-                                                0};  // if x then high else low
-                        return ret_id = get_id(bdd_node);
-                    } else {
-                        return ret_id = std::get<Bdd_ptype>(
-                                            globals[expression.name.lexeme])
-                                            .id;
-                    }
-                }
-
-                throw ExecutionException(
-                    "Variable not found: " + expression.name.lexeme,
-                    "Walker::construct_bdd");
-            } else {
-                throw std::runtime_error("Unsupported expression type");
-            }
-        },
-        x);
+    if (const auto it = expr_to_id_memo.find(&x);
+        it != expr_to_id_memo.end()) {
+        return it->second;
+    }
+    // Substitutions evaluate nested expressions, each in a frame of its own
+    if (program_depth == program_frames.size()) program_frames.emplace_back();
+    auto& [program, regs] = program_frames[program_depth++];
+    id_type result{};
+    try {
+        lower(x, program);
+        result = execute(program, regs);
+    } catch (...) {
+        --program_depth;
+        throw;
+    }
+    --program_depth;
+    return result;
+}
 
-    return ret_id;
+id_type Walker::substitute(const sub_expr& expression) {
+    const Trace_Span span{"substitute", "bdd"};
+    // The substituted tree only lives for this substitution, so a nested
+    // substitution cannot free it while it is walked
+    const substitution_map& sub_map = expression.substitutions;
+    auto body_bdd = construct_bdd(*expression.body);
+    auto reconstructed_expr = construct_expr(body_bdd);
+    Ast_Arena sub_arena;
+    auto substituted_expr =
+        substitute_expr(reconstructed_expr, sub_map, sub_arena);
+    sub_memo.clear();  // sub memo is for specific substitutions
+
+    // Nodes of the scratch arena are only remembered while it is alive, in a
+    // memo of their own
+    auto outer_memo = std::exchange(expr_to_id_memo, {});
+    id_type subbed_body{};
+    try {
+        subbed_body = construct_bdd(*substituted_expr);
+    } catch (...) {
+        expr_to_id_memo = std::move(outer_memo);
+        throw;
+    }
+    expr_to_id_memo = std::move(outer_memo);
+    return subbed_body;
 }
 
 id_type Walker::get_id(const Bdd_Node& node) {
     if (node.type == Bdd_Node::Bdd_type::FALSE) return 0;
     if (node.type == Bdd_Node::Bdd_type::TRUE) return 1;
 
+    if (base != nullptr) {
+        if (const auto found = base->find(node)) return *found;
+    }
+    if (parent != nullptr) {
+        if (const auto it = parent->node_to_id.find(node);
+            it != parent->node_to_id.end()) {
+            return it->second;
+        }
+    }
     if (const auto it = node_to_id.find(node); it != node_to_id.end()) {
         return it->second;
     } else {
@@ -155,25 +80,28 @@ id_type Walker::get_id(const Bdd_Node& node) {
 }
 
 template <typename Comb_Fn_Type>
-id_type Walker::rec_apply_quant(id_type a, std::span<std::string> bound_vars,
+id_type Walker::rec_apply_quant(id_type a,
+                                std::span<const uint32_t> bound_vars,
                                 Comb_Fn_Type comb_fn) {
-    // precondition: the first element of bound_vars >= a.var in bdd_ordering
+    // Bound variables above the top node do not occur in it
+    const Bdd_Node& node = node_of(a);
+    size_t var_index = 0;
+    while (var_index < bound_vars.size() && bound_vars[var_index] < node.var) {
+        ++var_index;
+    }
+    bound_vars = bound_vars.subspan(var_index);
     if (bound_vars.empty()) return a;
-    const Bdd_Node& node = id_to_iter[a]->first;
     const std::tuple memo_key = {a, bound_vars.size()};
     if (quantifier_memo.contains(memo_key)) {
+        ++stats.cache_hits;
         return quantifier_memo[memo_key];
     }
 
     // Base Cases
     if (node.type == Bdd_Node::Bdd_type::FALSE) return 0;
     if (node.type == Bdd_Node::Bdd_type::TRUE) return 1;
-    size_t var_index = 0;
-    while (var_index < bound_vars.size() &&
-           bdd_ordering_map[bound_vars[var_index]] <
-               bdd_ordering_map[node.var]) {
-        ++var_index;
-    }
+    ++stats.cache_misses;
+    const Depth_Guard depth_guard(stats);
 
     // Recursive Cases
     if (node.var == bound_vars[0]) {  // we quantify out this variable
@@ -191,9 +119,58 @@ id_type Walker::rec_apply_quant(id_type a, std::span<std::string> bound_vars,
     }
 }
 
+id_type Walker::quantify(const id_type a, std::vector<uint32_t> levels,
+                         const bool exists) {
+    if (a == 0 || a == 1) return a;
+    std::ranges::sort(levels);
+    const auto [first, last] = std::ranges::unique(levels);
+    levels.erase(first, last);
+
+    // Clear the quantifier memo but binary operation memos can be kept
+    const Trace_Span span{"quantify", "bdd"};
+    quantifier_memo.clear();
+    if (exists) {
+        return rec_apply_quant(a, levels,
+                               [this](const id_type x, const id_type y) {
+                                   return rec_apply_or(x, y);
+                               });
+    }
+    return rec_apply_quant(a, levels,
+                           [this](const id_type x, const id_type y) {
+                               return rec_apply_and(x, y);
+                           });
+}
+
+id_type Walker::rec_restrict(const id_type a, const uint32_t level,
+                             const bool value,
+                             std::unordered_map<id_type, id_type>& memo) {
+    const Bdd_Node& node = node_of(a);
+    if (node.var > level) return a;  // also the terminals
+    if (node.var == level) return value ? node.high : node.low;
+    if (const auto it = memo.find(a); it != memo.end()) return it->second;
+
+    const Depth_Guard depth_guard(stats);
+    const id_type high = rec_restrict(node.high, level, value, memo);
+    const id_type low = rec_restrict(node.low, level, value, memo);
+    if (high == low) return memo[a] = high;
+    return memo[a] = get_id(
+               Bdd_Node{Bdd_Node::Bdd_type::INTERNAL, node.var, high, low});
+}
+
+id_type Walker::compose(const id_type a, const uint32_t level,
+                        const id_type g) {
+    // a[x := g] = (g & a[x := 1]) | (!g & a[x := 0])
+    std::unordered_map<id_type, id_type> memo;
+    const id_type high = rec_restrict(a, level, true, memo);
+    memo.clear();
+    const id_type low = rec_restrict(a, level, false, memo);
+    return rec_apply_or(rec_apply_and(g, high),
+                        rec_apply_and(rec_apply_not(g), low));
+}
+
 id_type Walker::rec_apply_and(id_type a, id_type b) {
-    const Bdd_Node& node_a = id_to_iter[a]->first;
-    const Bdd_Node& node_b = id_to_iter[b]->first;
+    const Bdd_Node& node_a = node_of(a);
+    const Bdd_Node& node_b = node_of(b);
 
     // Base Cases
     if (node_a == node_b) return a;
@@ -207,17 +184,20 @@ id_type Walker::rec_apply_and(id_type a, id_type b) {
     // Use the memo with the AND operation type
     if (const auto mit = binop_memo.find(std::make_tuple(a, b, BinOpType::AND));
         mit != binop_memo.end()) {
+        ++stats.cache_hits;
         return mit->second;
     }
+    ++stats.cache_misses;
+    const Depth_Guard depth_guard(stats);
 
     // Recursive Cases
-    const std::string& a_var = node_a.var;
-    const std::string& b_var = node_b.var;
+    const uint32_t a_var = node_a.var;
+    const uint32_t b_var = node_b.var;
 
     id_type nhigh = 0;
     id_type nlow = 0;
 
-    const bool pivot_on_a = bdd_ordering_map[a_var] <= bdd_ordering_map[b_var];
+    const bool pivot_on_a = a_var <= b_var;
     if (a_var == b_var) {
         nhigh = rec_apply_and(node_a.high, node_b.high);
         nlow = rec_apply_and(node_a.low, node_b.low);
@@ -238,8 +218,8 @@ id_type Walker::rec_apply_and(id_type a, id_type b) {
 }
 
 id_type Walker::rec_apply_or(id_type a, id_type b) {
-    const Bdd_Node& node_a = id_to_iter[a]->first;
-    const Bdd_Node& node_b = id_to_iter[b]->first;
+    const Bdd_Node& node_a = node_of(a);
+    const Bdd_Node& node_b = node_of(b);
 
     // Base Cases
     if (node_a == node_b) return a;
@@ -253,17 +233,20 @@ id_type Walker::rec_apply_or(id_type a, id_type b) {
     // Use the memo with the OR operation type
     if (const auto mit = binop_memo.find(std::make_tuple(a, b, BinOpType::OR));
         mit != binop_memo.end()) {
+        ++stats.cache_hits;
         return mit->second;
     }
+    ++stats.cache_misses;
+    const Depth_Guard depth_guard(stats);
 
     // Recursive Cases
-    const std::string& a_var = node_a.var;
-    const std::string& b_var = node_b.var;
+    const uint32_t a_var = node_a.var;
+    const uint32_t b_var = node_b.var;
 
     id_type nhigh = 0;
     id_type nlow = 0;
 
-    const bool pivot_on_a = bdd_ordering_map[a_var] <= bdd_ordering_map[b_var];
+    const bool pivot_on_a = a_var <= b_var;
     if (a_var == b_var) {
         nhigh = rec_apply_or(node_a.high, node_b.high);
         nlow = rec_apply_or(node_a.low, node_b.low);
@@ -283,14 +266,17 @@ id_type Walker::rec_apply_or(id_type a, id_type b) {
 }
 
 id_type Walker::rec_apply_not(const id_type a) {
-    const Bdd_Node& node = id_to_iter[a]->first;
+    const Bdd_Node& node = node_of(a);
 
     // Base Cases
     if (node.type == Bdd_Node::Bdd_type::FALSE) return 1;
     if (node.type == Bdd_Node::Bdd_type::TRUE) return 0;
     if (const auto mit = not_memo.find(a); mit != not_memo.end()) {
+        ++stats.cache_hits;
         return mit->second;
     }
+    ++stats.cache_misses;
+    const Depth_Guard depth_guard(stats);
 
     // Recursive Cases
     const id_type left = rec_apply_not(node.high);
@@ -300,3 +286,83 @@ id_type Walker::rec_apply_not(const id_type a) {
                             right};
     return not_memo[a] = get_id(new_node);
 }
+
+std::optional<Nary_Schedule> parse_nary_schedule(const std::string_view name) {
+    if (name == "in_order") return Nary_Schedule::IN_ORDER;
+    if (name == "smallest") return Nary_Schedule::SMALLEST_FIRST;
+    if (name == "balanced") return Nary_Schedule::BALANCED;
+    return std::nullopt;
+}
+
+id_type Walker::apply_all(const BinOpType op, std::vector<id_type> operands,
+                          const Nary_Schedule schedule) {
+    const id_type unit = op == BinOpType::AND ? 1 : 0;  // x & true is x
+    const id_type zero = 1 - unit;                      // x & false is false
+    const auto apply = [this, op](const id_type a, const id_type b) {
+        if (op == BinOpType::AND) {
+            const Trace_Span span{"apply_and", "bdd"};
+            return rec_apply_and(a, b);
+        }
+        const Trace_Span span{"apply_or", "bdd"};
+        return rec_apply_or(a, b);
+    };
+
+    if (schedule == Nary_Schedule::IN_ORDER) {
+        id_type result = unit;
+        for (const id_type id : operands) {
+            result = apply(result, id);
+            if (result == zero) break;
+        }
+        return result;
+    }
+
+    std::erase(operands, unit);
+    if (operands.empty()) return unit;
+    if (std::ranges::find(operands, zero) != operands.end()) return zero;
+
+    if (schedule == Nary_Schedule::BALANCED) {
+        // Neighbours tend to share variables, and every operand takes part in
+        // about log n applications instead of up to n
+        while (operands.size() > 1) {
+            size_t kept = 0;
+            for (size_t i = 0; i < operands.size(); i += 2) {
+                const id_type result =
+                    i + 1 < operands.size()
+                        ? apply(operands[i], operands[i + 1])
+                        : operands[i];
+                if (result == zero) return zero;
+                operands[kept++] = result;
+            }
+            operands.resize(kept);
+        }
+        return operands.front();
+    }
+
+    // Always combining the two smallest keeps intermediate results small,
+    // unlike a left-deep chain where every step drags the whole result along
+    std::ranges::sort(operands);
+    const auto [first, last] = std::ranges::unique(operands);
+    operands.erase(first, last);
+
+    // Operands are measured once. A partial result is not traversed: its
+    // size is estimated by the nodes its apply created, which leaves out the
+    // nodes it shares with earlier BDDs.
+    using Sized = std::pair<size_t, id_type>;
+    std::priority_queue<Sized, std::vector<Sized>, std::greater<>> queue;
+    for (const id_type id : operands) queue.emplace(bdd_size(id), id);
+    while (queue.size() > 1) {
+        const auto [size_a, a] = queue.top();
+        queue.pop();
+        const auto [size_b, b] = queue.top();
+        queue.pop();
+        const id_type created = counter;
+        const id_type result = apply(a, b);
+        if (result == zero) return zero;
+        const size_t size =
+            result == a   ? size_a
+            : result == b ? size_b
+                          : std::max<id_type>(counter - created, 1);
+        queue.emplace(size, result);
+    }
+    return queue.top().second;
+}
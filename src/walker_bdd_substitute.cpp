@@ -5,45 +5,45 @@
 #include "engine_exceptions.h"
 #include "walker.h"
 
-std::shared_ptr<expr> Walker::construct_expr(const id_type id) {
+const expr* Walker::construct_expr(const id_type id) {
     if (id == 0) {
-        return false_expr;
+        return &false_expr;
     }
     if (id == 1) {
-        return true_expr;
+        return &true_expr;
     }
 
-    if (!id_to_iter.contains(id)) {
+    if (!has_node(id)) {
         throw ExecutionException("ID not found: " + std::to_string(id),
                                  "Walker::construct_expr");
     }
 
     if (id_to_expr_memo.contains(id)) return id_to_expr_memo[id];
 
-    const auto& node = id_to_iter[id]->first;
+    const auto& node = node_of(id);
     assert(node.type == Bdd_Node::Bdd_type::INTERNAL);
 
     // (x -> high) & (!x -> low) => (!x | high) & (x | low)
-    auto x = std::make_shared<expr>(
-        identifier{token{token::Type::IDENTIFIER, node.var}});
-    auto not_x =
-        std::make_shared<expr>(unary_expr{x, token{token::Type::BANG, "!"}});
+    const expr* x = expr_arena.make(
+        identifier{token{token::Type::IDENTIFIER, bdd_ordering[node.var]}});
+    const expr* not_x =
+        expr_arena.make(unary_expr{x, token{token::Type::BANG, "!"}});
 
-    auto x_implies_high = std::make_shared<expr>(
-        bin_expr{std::move(not_x), construct_expr(node.high),
-                 token{token::Type::LOR, "|"}});
-    auto not_x_implies_low = std::make_shared<expr>(bin_expr{
-        std::move(x), construct_expr(node.low), token{token::Type::LOR, "|"}});
+    const expr* x_implies_high = expr_arena.make(bin_expr{
+        not_x, construct_expr(node.high), token{token::Type::LOR, "|"}});
+    const expr* not_x_implies_low = expr_arena.make(
+        bin_expr{x, construct_expr(node.low), token{token::Type::LOR, "|"}});
 
     // Combine the two implications with AND
-    return id_to_expr_memo[id] = std::make_shared<expr>(
-               bin_expr{std::move(x_implies_high), std::move(not_x_implies_low),
-                        token{token::Type::LAND, "&"}});
+    return id_to_expr_memo[id] =
+               expr_arena.make(bin_expr{x_implies_high, not_x_implies_low,
+                                        token{token::Type::LAND, "&"}});
 }
 
-std::shared_ptr<expr> Walker::substitute_expr(const std::shared_ptr<expr>& x,
-                                              const substitution_map& sub_map) {
-    std::shared_ptr<expr> ret_expr{};
+const expr* Walker::substitute_expr(const expr* x,
+                                    const substitution_map& sub_map,
+                                    Ast_Arena& arena) {
+    const expr* ret_expr{};
 
     if (sub_memo.contains(x)) {
         // Return cached substituted expression
@@ -51,58 +51,54 @@ std::shared_ptr<expr> Walker::substitute_expr(const std::shared_ptr<expr>& x,
     }
 
     std::visit(
-        [&ret_expr, &sub_map, this]<typename T0>(const T0& exp) {
+        [&ret_expr, &sub_map, &arena, x, this]<typename T0>(const T0& exp) {
             using T = std::remove_cvref_t<T0>;
             if constexpr (std::is_same_v<T, bin_expr>) {
-                auto left_expr = substitute_expr(exp.left, sub_map);
-                auto right_expr = substitute_expr(exp.right, sub_map);
-                return ret_expr = std::make_shared<expr>(
-                           bin_expr{std::move(left_expr), std::move(right_expr),
-                                    exp.op});
+                const expr* left_expr =
+                    substitute_expr(exp.left, sub_map, arena);
+                const expr* right_expr =
+                    substitute_expr(exp.right, sub_map, arena);
+                return ret_expr =
+                           arena.make(bin_expr{left_expr, right_expr, exp.op});
 
             } else if constexpr (std::is_same_v<T, unary_expr>) {
-                auto operand_expr = substitute_expr(exp.operand, sub_map);
-                return ret_expr = std::make_shared<expr>(
-                           unary_expr{std::move(operand_expr), exp.op});
+                const expr* operand_expr =
+                    substitute_expr(exp.operand, sub_map, arena);
+                return ret_expr =
+                           arena.make(unary_expr{operand_expr, exp.op});
 
             } else if constexpr (std::is_same_v<T, literal>) {
                 if (exp.value.type == token::Type::ID) {
                     throw std::runtime_error(
                         "ID literals are not supported in substitution: " +
-                        exp.value.lexeme);
+                        std::string(exp.value.lexeme));
                 }
                 if (exp.value.type == token::Type::TRUE) {
-                    return ret_expr = true_expr;
+                    return ret_expr = &true_expr;
                 }
                 if (exp.value.type == token::Type::FALSE) {
-                    return ret_expr = false_expr;
+                    return ret_expr = &false_expr;
                 }
                 throw std::runtime_error("Unsupported literal type");
             } else if constexpr (std::is_same_v<T, identifier>) {
                 // Handle identifier
-                if (globals.contains(exp.name.lexeme)) {
-                    if (std::holds_alternative<Bvar_ptype>(
-                            globals[exp.name.lexeme])) {
-                        if (sub_map.contains(exp.name.lexeme)) {
-                            // Apply substitution
-                            return ret_expr = std::shared_ptr<expr>(
-                                       sub_map.at(exp.name.lexeme));
-                        }
-
-                        const auto& bvar =
-                            std::get<Bvar_ptype>(globals[exp.name.lexeme]);
-                        const Bdd_Node bdd_node{Bdd_Node::Bdd_type::INTERNAL,
-                                                bvar.name, 1, 0};
-                        return ret_expr = std::make_shared<expr>(identifier{
-                                   token{token::Type::IDENTIFIER, bvar.name}});
+                const symbol_id symbol = exp.name.symbol;
+                if (const Ptype* value = find_global(symbol);
+                    value != nullptr &&
+                    std::holds_alternative<Bvar_ptype>(*value)) {
+                    if (const auto sub = sub_map.find(symbol);
+                        sub != sub_map.end()) {
+                        // Apply substitution
+                        return ret_expr = sub->second;
                     }
+                    return ret_expr = x;
                 }
                 throw std::runtime_error(
                     "Only BDD variables are supported in substitution");
 
             } else {
                 throw std::runtime_error("Unsupported expression type");
-                return ret_expr = false_expr;
+                return ret_expr = &false_expr;
             }
         },
         *x);
@@ -1,4 +1,11 @@
+#include <cmath>
+#include <map>
 #include <queue>
+#include <ranges>
+#include <span>
+#include <unordered_map>
+
+#include "absl/container/flat_hash_set.h"
 
 #include "walker.h"
 
@@ -7,7 +14,7 @@ bool Walker::is_sat(const id_type a) {
     if (const auto it = is_sat_memo.find(a); it != is_sat_memo.end()) {
         return it->second;
     }
-    const Bdd_Node& node = id_to_iter[a]->first;
+    const Bdd_Node& node = node_of(a);
 
     // Base case set up in walker constructor
     // if (node.type == Bdd_Node::Bdd_type::TRUE) {
@@ -24,10 +31,10 @@ bool Walker::is_sat(const id_type a) {
 std::string Walker::bdd_repr(const id_type id) {
     // Prints the BDD as a tree
     // Caution: the tree representation can be exponentially large
-    const Bdd_Node& node = id_to_iter[id]->first;
+    const Bdd_Node& node = node_of(id);
     if (node.type == Bdd_Node::Bdd_type::INTERNAL) {
-        return node.var + " ? (" + bdd_repr(node.high) + ") : (" +
-               bdd_repr(node.low) + ")";
+        return std::string(bdd_ordering[node.var]) + " ? (" +
+               bdd_repr(node.high) + ") : (" + bdd_repr(node.low) + ")";
     } else if (node.type == Bdd_Node::Bdd_type::TRUE) {
         return "TRUE";
     } else if (node.type == Bdd_Node::Bdd_type::FALSE) {
@@ -49,7 +56,7 @@ std::unordered_set<id_type> Walker::get_bdd_nodes(const id_type id) {
         id_type current = q.front();
         q.pop();
 
-        if (const Bdd_Node& node = id_to_iter[current]->first;
+        if (const Bdd_Node& node = node_of(current);
             node.type == Bdd_Node::Bdd_type::INTERNAL) {
             if (!visited.contains(node.high)) {
                 q.push(node.high);
@@ -65,28 +72,121 @@ std::unordered_set<id_type> Walker::get_bdd_nodes(const id_type id) {
     return visited;
 }
 
-std::string Walker::bdd_gviz_repr(const id_type id) {
-    // Prints the BDD in Graphviz format
-    // Solid edges for high branches, dashed edges for low branches
-    const std::unordered_set<id_type> bdd_ids = get_bdd_nodes(id);
+size_t Walker::bdd_size(const id_type id) { return get_bdd_nodes(id).size(); }
 
-    std::string gviz = "digraph G {\n";
-    for (const auto& bdd_id : bdd_ids) {
-        const Bdd_Node& node = id_to_iter[bdd_id]->first;
+size_t Walker::write_dag(std::ostream& os, const id_type id,
+                         const size_t node_limit) {
+    // Writes each node once as `n7 = x ? n4 : n0`, children before parents,
+    // so the last line defines the root. Unlike bdd_repr, the output is
+    // linear in the size of the BDD and the traversal does not recurse.
+    absl::flat_hash_set<id_type> done;
+    std::vector<std::pair<id_type, bool>> stack{{id, false}};  // expanded?
+    size_t written = 0;
+    while (!stack.empty() && written < node_limit) {
+        const auto [bdd_id, expanded] = stack.back();
+        if (done.contains(bdd_id)) {
+            stack.pop_back();
+            continue;
+        }
+        const Bdd_Node& node = node_of(bdd_id);
+        if (node.type == Bdd_Node::Bdd_type::INTERNAL && !expanded) {
+            stack.back().second = true;
+            // Pushed in reverse so that the high branch is written first
+            for (const id_type child : {node.low, node.high}) {
+                if (!done.contains(child)) stack.emplace_back(child, false);
+            }
+            continue;
+        }
+        stack.pop_back();
+        done.insert(bdd_id);
+        ++written;
+        os << 'n' << bdd_id << " = ";
         if (node.type == Bdd_Node::Bdd_type::INTERNAL) {
-            gviz += "  " + std::to_string(bdd_id) + " [label=\"" + node.var +
-                    "\"];\n";
-            gviz += "  " + std::to_string(bdd_id) + " -> " +
-                    std::to_string(node.high) + " [style=\"solid\"];\n";
-            gviz += "  " + std::to_string(bdd_id) + " -> " +
-                    std::to_string(node.low) + " [style=\"dashed\"];\n";
-        } else if (node.type == Bdd_Node::Bdd_type::TRUE) {
-            gviz += "  " + std::to_string(bdd_id) + " [label=\"TRUE\"];\n";
-        } else if (node.type == Bdd_Node::Bdd_type::FALSE) {
-            gviz += "  " + std::to_string(bdd_id) + " [label=\"FALSE\"];\n";
+            os << bdd_ordering[node.var] << " ? n" << node.high << " : n"
+               << node.low << '\n';
+        } else {
+            os << (node.type == Bdd_Node::Bdd_type::TRUE ? "true" : "false")
+               << '\n';
+        }
+    }
+    return written;
+}
+
+size_t Walker::write_gviz(std::ostream& os, const id_type id,
+                          const size_t node_limit) {
+    // Writes the BDD in Graphviz format, one level at a time, with the nodes
+    // of each level in a rank=same subgraph so that Graphviz lines them up
+    // Solid edges for high branches, dashed edges for low branches
+    // Only the nodes of the levels not yet written are held in memory, and
+    // nodes reached after the limit are drawn as "..." placeholders
+    absl::flat_hash_set<id_type> seen{id};
+    std::map<uint32_t, std::vector<id_type>> pending;  // by level
+    pending[node_of(id).var].push_back(id);
+
+    size_t written = 0;
+    os << "digraph G {\n";
+    while (!pending.empty() && written < node_limit) {
+        auto level = pending.extract(pending.begin());
+        if (level.key() == terminal_level) {
+            os << "  subgraph terminals {\n    rank=same;\n";
+        } else {
+            os << "  subgraph level_" << level.key() << " {\n    rank=same;\n";
+        }
+        const size_t first = written;
+        for (const id_type bdd_id : level.mapped()) {
+            if (written == node_limit) {
+                pending[level.key()].push_back(bdd_id);
+                continue;
+            }
+            ++written;
+            const Bdd_Node& node = node_of(bdd_id);
+            os << "    " << bdd_id << " [label=\"";
+            if (node.type == Bdd_Node::Bdd_type::INTERNAL) {
+                os << bdd_ordering[node.var] << "\"];\n";
+            } else {
+                os << (node.type == Bdd_Node::Bdd_type::TRUE ? "TRUE" : "FALSE")
+                   << "\"];\n";
+            }
+        }
+        os << "  }\n";
+
+        // Edges go after the subgraph so that their targets are not ranked
+        for (const id_type bdd_id :
+             std::span(level.mapped()).subspan(0, written - first)) {
+            const Bdd_Node& node = node_of(bdd_id);
+            if (node.type != Bdd_Node::Bdd_type::INTERNAL) continue;
+            os << "  " << bdd_id << " -> " << node.high
+               << " [style=\"solid\"];\n";
+            os << "  " << bdd_id << " -> " << node.low
+               << " [style=\"dashed\"];\n";
+            for (const id_type child : {node.high, node.low}) {
+                if (seen.insert(child).second) {
+                    pending[node_of(child).var].push_back(child);
+                }
+            }
         }
     }
 
-    gviz += "}\n";
-    return gviz;
+    for (const auto& ids : pending | std::views::values) {
+        for (const id_type bdd_id : ids) {
+            os << "  " << bdd_id << " [label=\"...\", shape=none];\n";
+        }
+    }
+    os << "}\n";
+    return written;
+}
+
+double Walker::sat_count(const id_type a) {
+    // Fraction of all assignments that satisfy each node, scaled at the end
+    std::unordered_map<id_type, double> density;
+    const auto rec = [&](const auto& self, const id_type id) -> double {
+        if (id <= 1) return id;
+        if (const auto it = density.find(id); it != density.end()) {
+            return it->second;
+        }
+        const Bdd_Node& node = node_of(id);
+        return density[id] =
+                   (self(self, node.high) + self(self, node.low)) / 2;
+    };
+    return std::ldexp(rec(rec, a), static_cast<int>(bdd_ordering.size()));
 }
@@ -0,0 +1,394 @@
+// Lowering expressions to bytecode and running it (see bytecode.h)
+#include <algorithm>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "bytecode.h"
+#include "engine_exceptions.h"
+#include "trace.h"
+#include "walker.h"
+
+namespace {
+using Op = Bc_Instr::Op;
+
+// Appends instructions to a program, simplifying each one against the
+// instructions it uses. Operands of the same expression node share a
+// register, so syntactically identical operands are equal registers.
+class Builder {
+    Bytecode& program;
+    std::vector<Bc_Instr>& code;
+
+    bool is_const(const uint32_t r, const id_type id) const {
+        return code[r].op == Op::CONST && code[r].a == id;
+    }
+    std::span<const uint32_t> operands_of(const uint32_t r) const {
+        return std::span(program.operands).subspan(code[r].a, code[r].b);
+    }
+
+   public:
+    explicit Builder(Bytecode& program)
+        : program(program), code(program.code) {}
+
+    uint32_t emit(const Bc_Instr instr) {
+        code.push_back(instr);
+        return static_cast<uint32_t>(code.size() - 1);
+    }
+    uint32_t constant(const id_type id) { return emit({Op::CONST, id}); }
+    uint32_t negate(uint32_t r);
+    uint32_t combine(Op op, const std::vector<uint32_t>& terms);
+    uint32_t quantify(Op op, uint32_t body, uint32_t first, uint32_t count);
+};
+
+uint32_t Builder::negate(const uint32_t r) {
+    const Bc_Instr x = code[r];
+    switch (x.op) {
+        case Op::CONST:
+            if (x.a <= 1) return constant(1 - x.a);
+            break;
+        case Op::NOT:
+            return x.a;
+        case Op::AND:
+        case Op::OR: {
+            // De Morgan when every operand is a negation, which saves all of
+            // the negations
+            std::vector<uint32_t> inner;
+            for (const uint32_t t : operands_of(r)) {
+                if (code[t].op != Op::NOT) break;
+                inner.push_back(code[t].a);
+            }
+            if (inner.size() == x.b) {
+                return combine(x.op == Op::AND ? Op::OR : Op::AND, inner);
+            }
+            break;
+        }
+        case Op::EXISTS:
+        case Op::FORALL:
+            // !exists (v) !f is forall (v) f
+            if (code[x.a].op == Op::NOT) {
+                return quantify(x.op == Op::EXISTS ? Op::FORALL : Op::EXISTS,
+                                code[x.a].a, x.b, x.c);
+            }
+            break;
+        default:
+            break;
+    }
+    return emit({Op::NOT, r});
+}
+
+uint32_t Builder::combine(const Op op, const std::vector<uint32_t>& terms) {
+    const Op dual = op == Op::AND ? Op::OR : Op::AND;
+    const id_type unit = op == Op::AND ? 1 : 0;  // x & true is x
+
+    // Nested chains are flattened, dropping units and repeated operands
+    std::vector<uint32_t> flat;
+    std::unordered_set<uint32_t> seen;
+    const auto add = [&](const uint32_t t) {
+        if (!is_const(t, unit) && seen.insert(t).second) flat.push_back(t);
+    };
+    for (const uint32_t t : terms) {
+        if (code[t].op == op) {
+            for (const uint32_t u : operands_of(t)) add(u);
+        } else {
+            add(t);
+        }
+    }
+    // x & false and x & !x are false
+    for (const uint32_t t : flat) {
+        if (is_const(t, 1 - unit) ||
+            (code[t].op == Op::NOT && seen.contains(code[t].a))) {
+            return constant(1 - unit);
+        }
+    }
+    // Absorption: x & (x | y) is x
+    std::erase_if(flat, [&](const uint32_t t) {
+        return code[t].op == dual &&
+               std::ranges::any_of(operands_of(t), [&](const uint32_t u) {
+                   return seen.contains(u);
+               });
+    });
+
+    if (flat.empty()) return constant(unit);
+    if (flat.size() == 1) return flat.front();
+    const auto first = static_cast<uint32_t>(program.operands.size());
+    program.operands.insert(program.operands.end(), flat.begin(), flat.end());
+    return emit({op, first, static_cast<uint32_t>(flat.size())});
+}
+
+uint32_t Builder::quantify(const Op op, const uint32_t body,
+                           const uint32_t first, const uint32_t count) {
+    if (count == 0 || is_const(body, 0) || is_const(body, 1)) return body;
+    return emit({op, body, first, count});
+}
+
+// Drops instructions whose values are not needed, except those that can fail,
+// and renumbers the registers of the rest
+void prune(Bytecode& program) {
+    std::vector<Bc_Instr>& code = program.code;
+    std::vector<bool> live(code.size());
+    live[program.result] = true;
+    for (size_t i = code.size(); i-- > 0;) {
+        const Bc_Instr& instr = code[i];
+        if (instr.op == Op::FAIL || instr.op == Op::ID) live[i] = true;
+        if (!live[i]) continue;
+        if (instr.op == Op::AND || instr.op == Op::OR) {
+            for (uint32_t k = 0; k < instr.b; ++k) {
+                live[program.operands[instr.a + k]] = true;
+            }
+        } else if (instr.op == Op::NOT || instr.op == Op::EXISTS ||
+                   instr.op == Op::FORALL) {
+            live[instr.a] = true;
+        }
+    }
+
+    std::vector<uint32_t> renumbered(code.size());
+    std::vector<uint32_t> operands;
+    uint32_t next = 0;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!live[i]) continue;
+        Bc_Instr instr = code[i];
+        if (instr.op == Op::AND || instr.op == Op::OR) {
+            const auto first = static_cast<uint32_t>(operands.size());
+            for (uint32_t k = 0; k < instr.b; ++k) {
+                operands.push_back(
+                    renumbered[program.operands[instr.a + k]]);
+            }
+            instr.a = first;
+        } else if (instr.op == Op::NOT || instr.op == Op::EXISTS ||
+                   instr.op == Op::FORALL) {
+            instr.a = renumbered[instr.a];
+        }
+        renumbered[i] = next;
+        code[next++] = instr;
+    }
+    code.resize(next);
+    program.operands = std::move(operands);
+    program.result = renumbered[program.result];
+    std::erase_if(program.nodes,
+                  [&live](const auto& node) { return !live[node.second]; });
+    for (auto& node : program.nodes) node.second = renumbered[node.second];
+}
+}  // namespace
+
+void Walker::lower(const expr& root, Bytecode& program) {
+    program.clear();
+    Builder builder(program);
+    auto& reg = lowered_regs;
+    reg.clear();
+    const auto fail = [&program, &builder](std::string error) {
+        program.errors.push_back(std::move(error));
+        return builder.emit(
+            {Op::FAIL, static_cast<uint32_t>(program.errors.size() - 1)});
+    };
+    // The operands of a left-deep chain of one binary operator, left to
+    // right. The inner nodes of the chain get no register of their own, so a
+    // chain of n terms is flattened once rather than once per prefix.
+    const auto chain_of = [&](const bin_expr& bin) {
+        std::vector<const expr*> terms{bin.right};
+        const expr* left = bin.left;
+        while (const auto* inner = std::get_if<bin_expr>(left)) {
+            if (inner->op.type != bin.op.type || reg.contains(left) ||
+                expr_to_id_memo.contains(left)) {
+                break;
+            }
+            terms.push_back(inner->right);
+            left = inner->left;
+        }
+        terms.push_back(left);
+        std::ranges::reverse(terms);
+        return terms;
+    };
+    const auto lower_node = [&](const expr* node) -> uint32_t {
+        if (const auto* bin = std::get_if<bin_expr>(node)) {
+            if (bin->op.type != token::Type::LAND &&
+                bin->op.type != token::Type::LOR) {
+                throw std::runtime_error("Unsupported binary operator" +
+                                         std::string(bin->op.lexeme));
+            }
+            std::vector<uint32_t> terms;
+            for (const expr* operand : chain_of(*bin)) {
+                terms.push_back(reg.at(operand));
+            }
+            return builder.combine(
+                bin->op.type == token::Type::LAND ? Op::AND : Op::OR, terms);
+        } else if (const auto* nary = std::get_if<nary_expr>(node)) {
+            std::vector<uint32_t> terms;
+            for (const expr* operand : nary->operands) {
+                terms.push_back(reg.at(operand));
+            }
+            return builder.combine(
+                nary->op.type == token::Type::LAND ? Op::AND : Op::OR, terms);
+        } else if (const auto* un = std::get_if<unary_expr>(node)) {
+            if (un->op.type != token::Type::BANG) {
+                throw std::runtime_error("Unsupported unary operator");
+            }
+            return builder.negate(reg.at(un->operand));
+        } else if (const auto* q = std::get_if<quantifier_expr>(node)) {
+            if (q->quantifier.type != token::Type::EXISTS &&
+                q->quantifier.type != token::Type::FORALL) {
+                throw std::runtime_error("Unsupported quantifier type");
+            }
+            // Undeclared names cannot occur in the body
+            const auto first = static_cast<uint32_t>(program.levels.size());
+            for (const auto& var : q->bound_vars) {
+                if (const auto level = level_of(var.symbol)) {
+                    program.levels.push_back(*level);
+                }
+            }
+            const auto count =
+                static_cast<uint32_t>(program.levels.size()) - first;
+            return builder.quantify(q->quantifier.type == token::Type::EXISTS
+                                        ? Op::EXISTS
+                                        : Op::FORALL,
+                                    reg.at(q->body), first, count);
+        } else if (const auto* sub = std::get_if<sub_expr>(node)) {
+            program.substitutions.push_back(sub);
+            return builder.emit(
+                {Op::SUBSTITUTE,
+                 static_cast<uint32_t>(program.substitutions.size() - 1)});
+        } else if (const auto* lit = std::get_if<literal>(node)) {
+            const token& value = lit->value;
+            if (value.type == token::Type::ID) {
+                if (*value.token_value <= 1) {
+                    return builder.constant(*value.token_value);
+                }
+                program.errors.push_back("ID not found: " +
+                                         std::string(value.lexeme));
+                return builder.emit(
+                    {Op::ID, static_cast<uint32_t>(*value.token_value),
+                     static_cast<uint32_t>(program.errors.size() - 1)});
+            } else if (value.type == token::Type::TRUE) {
+                return builder.constant(1);
+            } else if (value.type == token::Type::FALSE) {
+                return builder.constant(0);
+            } else if (value.type == token::Type::STRING) {
+                return fail("Strings can only be used as file names: \"" +
+                            std::string(value.lexeme) + "\"");
+            }
+            throw std::runtime_error("Unsupported literal type");
+        }
+        const token& name = std::get<identifier>(*node).name;
+        if (const Ptype* value = find_global(name.symbol)) {
+            if (const auto* var = std::get_if<Bvar_ptype>(value)) {
+                return builder.emit({Op::VAR, var->level});
+            }
+            return builder.constant(std::get<Bdd_ptype>(*value).id);
+        }
+        return fail("Variable not found: " + std::string(name.lexeme));
+    };
+
+    // Children are lowered before their parent, left to right, which is the
+    // order the tree walk evaluated them in
+    std::vector<std::pair<const expr*, bool>> stack{{&root, false}};
+    while (!stack.empty()) {
+        const auto [node, expanded] = stack.back();
+        if (reg.contains(node)) {
+            stack.pop_back();
+            continue;
+        }
+        if (!expanded) {
+            stack.back().second = true;
+            if (const auto it = expr_to_id_memo.find(node);
+                it != expr_to_id_memo.end()) {
+                reg.emplace(node, builder.constant(it->second));
+                stack.pop_back();
+            } else if (const auto* bin = std::get_if<bin_expr>(node)) {
+                const std::vector<const expr*> terms = chain_of(*bin);
+                for (const expr* operand : terms | std::views::reverse) {
+                    stack.emplace_back(operand, false);
+                }
+            } else if (const auto* un = std::get_if<unary_expr>(node)) {
+                stack.emplace_back(un->operand, false);
+            } else if (const auto* q = std::get_if<quantifier_expr>(node)) {
+                stack.emplace_back(q->body, false);
+            } else if (const auto* nary = std::get_if<nary_expr>(node)) {
+                for (const expr* operand :
+                     nary->operands | std::views::reverse) {
+                    stack.emplace_back(operand, false);
+                }
+            }
+            continue;
+        }
+        stack.pop_back();
+        reg.emplace(node, lower_node(node));
+    }
+
+    program.result = reg.at(&root);
+    program.nodes.assign(reg.begin(), reg.end());
+    prune(program);
+}
+
+id_type Walker::execute(const Bytecode& program, std::vector<id_type>& regs) {
+    const std::vector<Bc_Instr>& code = program.code;
+    regs.resize(code.size());
+    for (size_t i = 0; i < code.size(); ++i) {
+        const Bc_Instr& instr = code[i];
+        switch (instr.op) {
+            case Op::CONST:
+                regs[i] = instr.a;
+                break;
+            case Op::VAR:
+                // if x then high else low
+                regs[i] = get_id(
+                    Bdd_Node{Bdd_Node::Bdd_type::INTERNAL, instr.a, 1, 0});
+                break;
+            case Op::NOT: {
+                const Trace_Span span{"apply_not", "bdd"};
+                regs[i] = rec_apply_not(regs[instr.a]);
+                break;
+            }
+            case Op::AND:
+            case Op::OR: {
+                const uint32_t* terms = &program.operands[instr.a];
+                if (instr.b == 2 && instr.op == Op::AND) {
+                    const Trace_Span span{"apply_and", "bdd"};
+                    regs[i] = rec_apply_and(regs[terms[0]], regs[terms[1]]);
+                } else if (instr.b == 2) {
+                    const Trace_Span span{"apply_or", "bdd"};
+                    regs[i] = rec_apply_or(regs[terms[0]], regs[terms[1]]);
+                } else {
+                    std::vector<id_type> ids(instr.b);
+                    for (uint32_t k = 0; k < instr.b; ++k) {
+                        ids[k] = regs[terms[k]];
+                    }
+                    regs[i] = apply_all(instr.op == Op::AND ? BinOpType::AND
+                                                            : BinOpType::OR,
+                                        std::move(ids), nary_schedule);
+                }
+                break;
+            }
+            case Op::EXISTS:
+            case Op::FORALL: {
+                const auto levels = std::span(program.levels)
+                                        .subspan(instr.b, instr.c);
+                regs[i] = quantify(regs[instr.a],
+                                   {levels.begin(), levels.end()},
+                                   instr.op == Op::EXISTS);
+                break;
+            }
+            case Op::SUBSTITUTE:
+                regs[i] = substitute(*program.substitutions[instr.a]);
+                break;
+            case Op::ID:
+                if (!has_node(instr.a)) {
+                    throw ExecutionException(program.errors[instr.b],
+                                             "Walker::construct_bdd");
+                }
+                regs[i] = instr.a;
+                break;
+            case Op::FAIL:
+                throw ExecutionException(program.errors[instr.a],
+                                         "Walker::construct_bdd");
+        }
+    }
+
+    for (const auto& [node, r] : program.nodes) {
+        expr_to_id_memo.emplace(node, regs[r]);
+    }
+    return regs[program.result];
+}
@@ -0,0 +1,173 @@
+// Concurrent evaluation of independent assignments
+//
+// A run of consecutive assignments is split into waves by schedule_waves,
+// and the store only changes between waves. During a wave each assignment
+// is evaluated by a worker Walker that reads this walker's nodes and
+// bindings, which are left untouched, and keeps the nodes it creates to
+// itself. The results are then adopted and bound in program order, so node
+// ids depend on the schedule but not on which worker finished first. A wave
+// of a single assignment is evaluated here directly.
+//
+// Output is held back until the run has finished. If an assignment fails,
+// bindings made by later assignments in earlier waves are undone, leaving
+// the session as if the statements had run one at a time up to the error.
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "trace.h"
+#include "walker.h"
+
+Walker::Walker(const Walker* parent_walker)
+    : counter(parent_walker->counter),
+      base(parent_walker->base),
+      base_nodes(parent_walker->base_nodes),
+      base_size(parent_walker->base_size),
+      base_vars(parent_walker->base_vars),
+      parent(parent_walker),
+      parent_limit(parent_walker->counter),
+      bdd_ordering(parent_walker->bdd_ordering),
+      nary_schedule(parent_walker->nary_schedule) {}
+
+std::vector<Stmt_Access> Walker::concurrent_run(
+    const std::span<const stmt> statements) const {
+    std::vector<Stmt_Access> accesses;
+    if (statement_threads <= 1 || profiling) return accesses;
+    for (const auto& statement : statements) {
+        const auto* assign = std::get_if<assign_stmt>(&statement);
+        if (assign == nullptr) break;
+        // Assigning to a symbolic variable only prints a warning
+        if (const Ptype* value = find_global(assign->target.name.symbol);
+            value != nullptr && std::holds_alternative<Bvar_ptype>(*value)) {
+            break;
+        }
+        auto access = access_of(*assign);
+        if (!access.has_value()) break;
+        accesses.push_back(std::move(*access));
+    }
+    return accesses;
+}
+
+id_type Walker::adopt(const Walker& worker, const id_type id) {
+    std::unordered_map<id_type, id_type> adopted;
+    const auto rec = [&](const auto& self, const id_type local) -> id_type {
+        if (local < worker.parent_limit) return local;  // already ours
+        if (const auto it = adopted.find(local); it != adopted.end()) {
+            return it->second;
+        }
+        const Bdd_Node& node = worker.node_of(local);
+        return adopted[local] = get_id(Bdd_Node{
+                   node.type, node.var, self(self, node.high),
+                   self(self, node.low)});
+    };
+    return rec(rec, id);
+}
+
+bool Walker::walk_concurrent(const std::span<const stmt> statements,
+                             const std::span<const Stmt_Access> accesses) {
+    const Trace_Span span{"concurrent_run", "walker"};
+    const std::vector<uint32_t> waves = schedule_waves(accesses);
+    std::vector<std::vector<size_t>> by_wave(std::ranges::max(waves) + 1);
+    for (size_t i = 0; i < waves.size(); ++i) by_wave[waves[i]].push_back(i);
+
+    const auto value_of = [&](const size_t i) -> const expr& {
+        return *std::get<assign_stmt>(statements[i]).value;
+    };
+    std::vector<std::string> outputs(statements.size());
+    std::vector<std::optional<Ptype>> replaced(statements.size());
+    std::vector<bool> bound(statements.size());
+    size_t failed = statements.size();  // first failure in program order
+
+    for (const auto& wave : by_wave) {
+        // Nothing after a failed assignment is started
+        std::vector<size_t> todo;
+        for (const size_t i : wave) {
+            if (i < failed) todo.push_back(i);
+        }
+        std::vector<std::optional<id_type>> ids(todo.size());
+
+        if (todo.size() == 1) {
+            try {
+                ids[0] = construct_bdd(value_of(todo[0]));
+            } catch (const std::exception& e) {
+                std::ostringstream error;
+                write_error(error, e);
+                outputs[todo[0]] = error.str();
+            }
+        } else if (todo.size() > 1) {
+            std::vector<std::unique_ptr<Walker>> workers(todo.size());
+            std::vector<std::optional<id_type>> local_ids(todo.size());
+            std::atomic<size_t> next{0};
+            const auto work = [&] {
+                for (size_t k; (k = next++) < todo.size();) {
+                    workers[k].reset(new Walker(this));
+                    try {
+                        local_ids[k] = workers[k]->construct_bdd(
+                            value_of(todo[k]));
+                    } catch (const std::exception& e) {
+                        write_error(workers[k]->out, e);
+                    }
+                }
+            };
+            {
+                const size_t helpers =
+                    std::min(statement_threads, todo.size()) - 1;
+                std::vector<std::jthread> threads;
+                threads.reserve(helpers);
+                for (size_t t = 0; t < helpers; ++t) threads.emplace_back(work);
+                work();
+            }  // joined here
+            for (size_t k = 0; k < todo.size(); ++k) {
+                if (local_ids[k].has_value()) {
+                    ids[k] = adopt(*workers[k], *local_ids[k]);
+                } else {
+                    outputs[todo[k]] = workers[k]->get_output();
+                }
+                workers[k].reset();
+            }
+        }
+
+        for (size_t k = 0; k < todo.size(); ++k) {
+            const size_t i = todo[k];
+            if (i > failed) break;  // todo is in program order
+            if (!ids[k].has_value()) {
+                failed = i;
+                break;
+            }
+            const token& target =
+                std::get<assign_stmt>(statements[i]).target.name;
+            if (const Ptype* value = globals.find(target.symbol)) {
+                replaced[i] = *value;
+                expr_to_id_memo.clear();  // nodes naming it may now differ
+            }
+            globals.bind(target.symbol, Bdd_ptype{target.lexeme, *ids[k]});
+            bound[i] = true;
+            std::ostringstream line;
+            line << "Assigned to " << target.lexeme
+                 << " with BDD ID: " << *ids[k] << '\n';
+            outputs[i] = line.str();
+        }
+    }
+
+    // Undone latest first, so a name written twice gets its first value back
+    for (size_t i = statements.size(); i-- > failed + 1;) {
+        if (!bound[i]) continue;
+        const symbol_id target =
+            std::get<assign_stmt>(statements[i]).target.name.symbol;
+        if (replaced[i].has_value()) {
+            globals.bind(target, *replaced[i]);
+        } else {
+            globals.erase(target);
+        }
+        expr_to_id_memo.clear();
+    }
+    for (size_t i = 0; i < statements.size() && i <= failed; ++i) {
+        out << outputs[i];
+    }
+    return failed == statements.size();
+}
@@ -0,0 +1,81 @@
+// AIGER and BLIF import
+//
+// The netlist is first read into a structurally hashed AIG (circuit.h), so
+// shared and duplicated gates are built only once. Inputs are ordered by a
+// depth-first traversal from the outputs, which keeps inputs that feed the
+// same logic close together in the ordering. The BDD of every gate is then
+// built once, in topological order, from the BDDs of its fanins.
+#include <fstream>
+#include <ranges>
+#include <vector>
+
+#include "circuit.h"
+#include "engine_exceptions.h"
+#include "trace.h"
+#include "walker.h"
+
+namespace {
+// Inputs in the order a depth-first traversal from the outputs first reaches
+// them, followed by any inputs that no output depends on
+std::vector<uint32_t> dfs_input_order(const Aig& aig) {
+    const auto num_inputs = static_cast<uint32_t>(aig.inputs.size());
+    std::vector<bool> visited(num_inputs + aig.gates.size() + 1);
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> stack;
+    for (const uint32_t lit : aig.outputs | std::views::values) {
+        stack.push_back(lit / 2);
+        while (!stack.empty()) {
+            const uint32_t var = stack.back();
+            stack.pop_back();
+            if (var == 0 || visited[var]) continue;
+            visited[var] = true;
+            if (var <= num_inputs) {
+                order.push_back(var - 1);
+            } else {
+                // Pushed in reverse so that the first fanin is visited first
+                const auto [fanin0, fanin1] = aig.gates[var - num_inputs - 1];
+                stack.push_back(fanin1 / 2);
+                stack.push_back(fanin0 / 2);
+            }
+        }
+    }
+    for (uint32_t var = 1; var <= num_inputs; ++var) {
+        if (!visited[var]) order.push_back(var - 1);
+    }
+    return order;
+}
+}  // namespace
+
+void Walker::import_circuit(const std::string& path, const std::string& target,
+                            const bool blif) {
+    const Trace_Span span{blif ? "load_blif" : "load_aiger", "io"};
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) {
+        throw ExecutionException("Failed to open file: " + path, __func__);
+    }
+    const Aig aig = blif ? read_blif(f) : read_aiger(f);
+
+    // bdds[var] is the BDD of AIG variable var
+    const auto num_inputs = static_cast<uint32_t>(aig.inputs.size());
+    std::vector<id_type> bdds(num_inputs + aig.gates.size() + 1);
+    for (const uint32_t input : dfs_input_order(aig)) {
+        const uint32_t level = declare_var(aig.inputs[input]);
+        bdds[input + 1] =
+            get_id(Bdd_Node{Bdd_Node::Bdd_type::INTERNAL, level, 1, 0});
+    }
+    const auto bdd_of = [&](const uint32_t lit) {
+        return lit % 2 == 0 ? bdds[lit / 2] : rec_apply_not(bdds[lit / 2]);
+    };
+    for (size_t g = 0; g < aig.gates.size(); ++g) {
+        const auto [fanin0, fanin1] = aig.gates[g];
+        bdds[num_inputs + 1 + g] =
+            rec_apply_and(bdd_of(fanin0), bdd_of(fanin1));
+    }
+
+    out << "Loaded circuit with " << num_inputs << " inputs, "
+        << aig.gates.size() << " gates and " << aig.outputs.size()
+        << " outputs from " << path << '\n';
+    for (const auto& [name, lit] : aig.outputs) {
+        bind_bdd(target + "." + name, bdd_of(lit));
+    }
+}
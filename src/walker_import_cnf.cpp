@@ -0,0 +1,174 @@
+// DIMACS CNF import
+//
+// The file is read a line at a time and each clause becomes a BDD as soon as
+// it is complete: a clause is a chain of nodes, built directly from its
+// deepest literal upwards without any apply calls. Clauses are clustered by
+// their top variable, so that clauses over nearby variables are conjoined
+// first, and the clusters are then combined smallest first.
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <ranges>
+#include <string_view>
+#include <vector>
+
+#include "engine_exceptions.h"
+#include "trace.h"
+#include "walker.h"
+
+namespace {
+// A literal as a level in the ordering and a polarity
+struct Cnf_Literal {
+    uint32_t level;
+    bool positive;
+
+    auto operator<=>(const Cnf_Literal&) const = default;
+};
+
+std::string_view trim(std::string_view s) {
+    const auto begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string_view::npos) return {};
+    const auto end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+}  // namespace
+
+void Walker::import_cnf(const std::string& path, const std::string& target) {
+    const Trace_Span span{"load_cnf", "io"};
+    std::ifstream f(path);
+    if (!f.is_open()) {
+        throw ExecutionException("Failed to open file: " + path, __func__);
+    }
+    const auto fail = [&](const size_t line_no, const std::string& what) {
+        throw ExecutionException(std::format("{}:{}: {}", path, line_no, what),
+                                 "Walker::import_cnf");
+    };
+
+    // Variable i of the file is the symbolic variable v{i}. Variables are
+    // declared when first used, along with every smaller one so that they
+    // stay in numeric order, rather than all that the problem line claims.
+    std::vector<uint32_t> levels;
+    const auto level_of = [&](const int var) {
+        const auto index = static_cast<size_t>(var);
+        if (index >= levels.size()) {
+            for (size_t i = levels.size(); i <= index; ++i) {
+                levels.push_back(
+                    i == 0 ? 0 : declare_var(std::format("v{}", i)));
+            }
+        }
+        return levels[index];
+    };
+
+    std::map<uint32_t, std::vector<id_type>> clusters;  // by top level
+    std::vector<Cnf_Literal> clause;
+    size_t num_clauses = 0;
+    int header_vars = 0;
+    int header_clauses = 0;
+    bool seen_header = false;
+    bool unsatisfiable = false;
+
+    const auto finish_clause = [&] {
+        ++num_clauses;
+        // Deepest literal first; a duplicate is dropped and a variable of
+        // both polarities makes the clause a tautology
+        std::ranges::sort(clause, std::greater{});
+        const auto [first, last] = std::ranges::unique(clause);
+        clause.erase(first, last);
+        for (size_t i = 1; i < clause.size(); ++i) {
+            if (clause[i].level == clause[i - 1].level) {
+                clause.clear();
+                return;
+            }
+        }
+        if (clause.empty()) {
+            unsatisfiable = true;
+            return;
+        }
+
+        id_type id = 0;
+        for (const auto& [level, positive] : clause) {
+            id = get_id(Bdd_Node{Bdd_Node::Bdd_type::INTERNAL, level,
+                                 positive ? id_type{1} : id,
+                                 positive ? id : id_type{1}});
+        }
+        clusters[clause.back().level].push_back(id);
+        clause.clear();
+    };
+
+    std::string line;
+    size_t line_no = 0;
+    while (!unsatisfiable && std::getline(f, line)) {
+        ++line_no;
+        std::string_view rest = trim(line);
+        if (rest.empty() || rest.front() == 'c') continue;
+        if (rest.front() == '%') break;  // end marker used by some benchmarks
+        if (rest.front() == 'p') {
+            char format[8]{};
+            if (seen_header ||
+                std::sscanf(line.c_str(), " p %7s %d %d", format, &header_vars,
+                            &header_clauses) != 3 ||
+                std::string_view(format) != "cnf" || header_vars < 0 ||
+                header_clauses < 0) {
+                fail(line_no, "Malformed problem line");
+            }
+            seen_header = true;
+            continue;
+        }
+        if (!seen_header) fail(line_no, "Clause before problem line");
+
+        // Clauses may span lines and several may share one
+        while (!rest.empty()) {
+            int literal = 0;
+            const char* const last = rest.data() + rest.size();
+            const auto [end, ec] = std::from_chars(rest.data(), last, literal);
+            if (ec != std::errc{} ||
+                (end != last && *end != ' ' && *end != '\t')) {
+                fail(line_no, "Expected a literal");
+            }
+            rest = trim(rest.substr(static_cast<size_t>(end - rest.data())));
+            if (literal == 0) {
+                finish_clause();
+                if (unsatisfiable) break;
+            } else if (literal == std::numeric_limits<int>::min()) {
+                fail(line_no, "Expected a literal");
+            } else if (std::abs(literal) > header_vars) {
+                fail(line_no, std::format("Variable {} exceeds the problem "
+                                          "line's {} variables",
+                                          std::abs(literal), header_vars));
+            } else {
+                clause.push_back({level_of(std::abs(literal)), literal > 0});
+            }
+        }
+    }
+    if (!clause.empty()) fail(line_no, "Clause not terminated by 0");
+    if (!seen_header) fail(line_no, "Missing problem line");
+    // An empty clause stops the import early, so only a complete read can
+    // tell whether the file is truncated
+    if (!unsatisfiable && num_clauses < static_cast<size_t>(header_clauses)) {
+        fail(line_no, std::format("Expected {} clauses but found {}",
+                                  header_clauses, num_clauses));
+    }
+
+    id_type result = 0;
+    if (!unsatisfiable) {
+        std::vector<id_type> parts;
+        parts.reserve(clusters.size());
+        for (auto& cluster : clusters | std::views::values) {
+            parts.push_back(apply_all(BinOpType::AND, std::move(cluster),
+                                      Nary_Schedule::SMALLEST_FIRST));
+            if (parts.back() == 0) break;
+        }
+        result = apply_all(BinOpType::AND, std::move(parts),
+                           Nary_Schedule::SMALLEST_FIRST);
+    }
+
+    const size_t num_vars = levels.empty() ? 0 : levels.size() - 1;
+    out << "Loaded " << num_clauses << " clauses over " << num_vars
+        << " variables from " << path << '\n';
+    bind_bdd(target, result);
+}
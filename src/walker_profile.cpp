@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <format>
+#include <ostream>
+#include <ranges>
+#include <string>
+#include <string_view>
+
+#include "alloc_stats.h"
+#include "walker.h"
+
+void Walker::set_profiling(const bool enabled) {
+    if (enabled) {
+        profile.clear();
+        profiled_count = 0;
+    }
+    profiling = enabled;
+}
+
+void Walker::walk_profiled(const stmt& statement) {
+    // Snapshot the counters, run the statement, and record the deltas. The
+    // statement is recorded even if it throws, since a failing statement is
+    // usually the interesting one.
+    const id_type nodes_before = counter;
+    const uint64_t hits_before = stats.cache_hits;
+    const uint64_t misses_before = stats.cache_misses;
+    stats.peak_depth = stats.depth;
+    alloc_stats::reset_peak();
+    const Alloc_Snapshot heap_before = alloc_stats::snapshot();
+    const auto start = std::chrono::steady_clock::now();
+
+    auto record = [&] {
+        const Alloc_Snapshot heap = alloc_stats::snapshot();
+        profile.push_back(Stmt_Profile{
+            .index = profiled_count++,
+            .label = stmt_summary(statement),
+            .wall_time = std::chrono::steady_clock::now() - start,
+            .nodes_created = counter - nodes_before,
+            .cache_hits = stats.cache_hits - hits_before,
+            .cache_misses = stats.cache_misses - misses_before,
+            .peak_depth = stats.peak_depth - stats.depth,
+            .allocations = heap.allocations - heap_before.allocations,
+            .allocated_bytes = heap.bytes - heap_before.bytes,
+            .peak_heap_bytes =
+                heap.peak_live_bytes - heap_before.live_bytes,
+        });
+    };
+
+    try {
+        walk_raw(statement);
+    } catch (...) {
+        record();
+        throw;
+    }
+    record();
+}
+
+void Walker::write_profile_report(std::ostream& os, const size_t top_n) const {
+    // Prints the top_n most expensive statements by wall time
+    std::chrono::nanoseconds total_time{};
+    uint64_t total_nodes = 0;
+    for (const auto& p : profile) {
+        total_time += p.wall_time;
+        total_nodes += p.nodes_created;
+    }
+
+    std::vector<const Stmt_Profile*> sorted;
+    sorted.reserve(profile.size());
+    for (const auto& p : profile) sorted.push_back(&p);
+    const size_t shown = std::min(top_n, sorted.size());
+    std::ranges::partial_sort(sorted, sorted.begin() + shown,
+                              [](const auto* a, const auto* b) {
+                                  return a->wall_time > b->wall_time;
+                              });
+
+    os << std::format("Profile: {} statements, {:.3f} ms, {} nodes created\n",
+                      profile.size(), total_time.count() / 1e6, total_nodes);
+    // Allocation columns only mean something when the counting hook is in
+    const bool heap = alloc_stats::enabled();
+    os << std::format("{:>8} {:>12} {:>10} {:>12} {:>12} {:>7}", "#",
+                      "time (ms)", "nodes", "cache hits", "cache misses",
+                      "depth");
+    if (heap) os << std::format(" {:>10} {:>12}", "allocs", "peak heap");
+    os << "  statement\n";
+    for (const auto* p : sorted | std::views::take(shown)) {
+        constexpr size_t max_label = 60;
+        std::string label = p->label;
+        if (label.size() > max_label) {
+            label.resize(max_label - 3);
+            label += "...";
+        }
+        os << std::format("{:>8} {:>12.3f} {:>10} {:>12} {:>12} {:>7}",
+                          p->index, p->wall_time.count() / 1e6,
+                          p->nodes_created, p->cache_hits, p->cache_misses,
+                          p->peak_depth);
+        if (heap) {
+            os << std::format(" {:>10} {:>12}", p->allocations,
+                              p->peak_heap_bytes);
+        }
+        os << "  " << label << '\n';
+    }
+}
+
+// Labels quote file names, so embedded quotes are doubled as in RFC 4180
+static std::string csv_quote(const std::string_view field) {
+    std::string quoted = "\"";
+    for (const char c : field) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + '"';
+}
+
+void Walker::write_profile_csv(std::ostream& os) const {
+    os << "index,statement,wall_ns,nodes_created,cache_hits,cache_misses,"
+          "peak_depth,allocations,allocated_bytes,peak_heap_bytes\n";
+    for (const auto& p : profile) {
+        os << std::format("{},{},{},{},{},{},{},{},{},{}\n", p.index,
+                          csv_quote(p.label), p.wall_time.count(),
+                          p.nodes_created, p.cache_hits, p.cache_misses,
+                          p.peak_depth, p.allocations, p.allocated_bytes,
+                          p.peak_heap_bytes);
+    }
+}
@@ -0,0 +1,134 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <ranges>
+#include <unordered_map>
+#include <vector>
+
+#include "engine_exceptions.h"
+#include "snapshot.h"
+#include "trace.h"
+#include "walker.h"
+
+void Walker::save_snapshot(const std::string& path) {
+    const Trace_Span span{"save_snapshot", "io"};
+
+    // Base layer ids are already dense; the rest are renumbered after them
+    // in creation order, which keeps children before their parents
+    std::vector<id_type> ids;
+    ids.reserve(id_to_iter.size());
+    for (const auto& id : id_to_iter | std::views::keys) ids.push_back(id);
+    std::ranges::sort(ids);
+
+    std::unordered_map<id_type, id_type> dense;
+    for (id_type i = 0; i < ids.size(); ++i) dense[ids[i]] = base_size + i;
+    const auto renumber = [&](const id_type id) {
+        return id < base_size ? id : dense[id];
+    };
+
+    std::vector<Bdd_Node> nodes(base_nodes, base_nodes + base_size);
+    nodes.reserve(base_size + ids.size());
+    for (const id_type id : ids) {
+        const Bdd_Node& node = node_of(id);
+        nodes.push_back(Bdd_Node{node.type, node.var, renumber(node.high),
+                                 renumber(node.low)});
+    }
+
+    std::vector<Snapshot_Binding> bindings;
+    for (const auto& value : globals.values()) {
+        if (const auto* bdd = std::get_if<Bdd_ptype>(&value)) {
+            bindings.push_back({std::string(bdd->name), renumber(bdd->id),
+                                bdd->preserved});
+        }
+    }
+    // Sorted so that saving the same session twice gives identical files
+    std::ranges::sort(bindings, {}, &Snapshot_Binding::name);
+
+    // The file may be mapped by this or another process, so it is replaced
+    // by renaming a complete copy over it rather than rewritten in place
+    const std::string temp_path = path + ".tmp";
+    std::ofstream f(temp_path, std::ios::binary);
+    if (!f.is_open()) {
+        throw ExecutionException("Failed to open file: " + temp_path,
+                                 __func__);
+    }
+    write_snapshot(f, nodes, bdd_ordering, bindings);
+    f.close();
+    const int fd = ::open(temp_path.c_str(), O_RDONLY);
+    const bool synced = fd != -1 && ::fsync(fd) == 0;
+    if (fd != -1) ::close(fd);
+    if (f.fail() || !synced ||
+        std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw ExecutionException("Failed to write file: " + path, __func__);
+    }
+    out << "Saved " << nodes.size() - 2 << " nodes, " << bdd_ordering.size()
+        << " variables and " << bindings.size() << " bindings to " << path
+        << '\n';
+}
+
+void Walker::load_snapshot(const std::string& path) {
+    const Trace_Span span{"load_snapshot", "io"};
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) {
+        throw ExecutionException("Failed to open file: " + path, __func__);
+    }
+    const std::string buffer{std::istreambuf_iterator(f), {}};
+    const Snapshot_View snapshot(buffer);
+    snapshot.validate();  // before the current state is touched
+    const auto& nodes = snapshot.nodes;
+
+    // get_id hands out ids in order, so the loaded nodes keep their ids
+    reset_store();
+    for (const auto& var : snapshot.vars) declare_var(var);
+    std::vector<id_type> ids{0, 1};
+    ids.reserve(nodes.size());
+    for (const auto& node : nodes.subspan(2)) {
+        ids.push_back(get_id(Bdd_Node{node.type, node.var, ids[node.high],
+                                      ids[node.low]}));
+    }
+    for (const auto& [name, node, preserved] : snapshot.bindings) {
+        if (const auto [symbol, interned] = intern(name);
+            !level_of(symbol).has_value()) {
+            globals.bind(symbol, Bdd_ptype{interned, ids[node], preserved});
+        }
+    }
+
+    out << "Loaded " << nodes.size() - 2 << " nodes, " << bdd_ordering.size()
+        << " variables and " << snapshot.bindings.size() << " bindings from "
+        << path << '\n';
+}
+
+void Walker::map_snapshot(const std::string& path) {
+    // The nodes are used in place and only read on demand, so the pages are
+    // shared with every other process mapping the file
+    auto mapped = Mapped_Snapshot::open(path);
+
+    reset_store();
+    base_nodes = mapped->view.nodes.data();
+    base_size = static_cast<id_type>(mapped->view.nodes.size());
+    base_vars = static_cast<uint32_t>(mapped->view.vars.size());
+    counter = base_size;
+    for (const auto& var : mapped->view.vars) declare_var(var);
+    for (const auto& [name, node, preserved] : mapped->view.bindings) {
+        if (const auto [symbol, interned] = intern(name);
+            !level_of(symbol).has_value()) {
+            globals.bind(symbol, Bdd_ptype{interned, node, preserved});
+        }
+    }
+    base = std::move(mapped);
+
+    out << "Mapped " << base_size - 2 << " nodes, " << bdd_ordering.size()
+        << " variables and " << base->view.bindings.size()
+        << " bindings from " << path << '\n';
+}
+
+void Walker::throw_malformed_node(const id_type id) {
+    throw ExecutionException(std::format("Malformed node {} in snapshot", id),
+                             "node_of");
+}
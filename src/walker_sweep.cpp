@@ -1,46 +1,78 @@
 #include <queue>
 
+#include "snapshot.h"
+#include "trace.h"
 #include "walker.h"
 
+static constexpr Bdd_Node terminal_nodes[2] = {
+    {Bdd_Node::Bdd_type::FALSE, terminal_level, 0, 0},
+    {Bdd_Node::Bdd_type::TRUE, terminal_level, 1, 1},
+};
+
 void Walker::clear_memos() {  // for later: Implement garbage collection
     binop_memo.clear();
     not_memo.clear();
     is_sat_memo.clear();
     id_to_expr_memo.clear();
+    expr_arena.clear();  // after the memo that points into it
+    expr_to_id_memo.clear();
+    is_sat_memo[0] = false;  // base cases for is_sat
+    is_sat_memo[1] = true;
+}
+
+void Walker::reset_store() {
+    peak_nodes = get_peak_nodes();
+    node_to_id.clear();
+    id_to_iter.clear();
+    globals.clear();
+    bdd_ordering.clear();
+    clear_memos();
+    quantifier_memo.clear();
+    sub_memo.clear();
+
+    // The terminals are the whole base layer until a snapshot is mapped
+    base.reset();
+    base_nodes = terminal_nodes;
+    base_size = 2;
+    base_vars = 0;
+    counter = 2;
 }
 
 void Walker::sweep() {
-    std::unordered_set<id_type> preserved_ids{0, 1};
-    // Always preserve the false and true nodes
+    const Trace_Span span{"sweep", "memory"};
+    peak_nodes = get_peak_nodes();
+    // Base layer nodes (the terminals and any mapped snapshot) are never
+    // swept, and only ever point to other base layer nodes
+    std::unordered_set<id_type> preserved_ids;
     clear_memos();  // Clear reusable memos before sweeping
 
     // First, collect all IDs that are preserved
-    for (auto it = globals.begin(); it != globals.end();) {
-        if (auto value = it->second; std::holds_alternative<Bdd_ptype>(value)) {
-            if (const auto& bdd = std::get<Bdd_ptype>(value); bdd.preserved) {
-                std::queue<id_type> to_process;
-                to_process.push(bdd.id);
-                while (!to_process.empty()) {
-                    id_type current_id = to_process.front();
-                    to_process.pop();
-
-                    if (preserved_ids.contains(current_id)) continue;
-                    preserved_ids.insert(current_id);
-
-                    if (const Bdd_Node& node = id_to_iter[current_id]->first;
-                        node.type == Bdd_Node::Bdd_type::INTERNAL) {
-                        to_process.push(node.high);
-                        to_process.push(node.low);
-                    }
-                }
-                ++it;  // preserve this
-            } else {
-                it = globals.erase(it);  // Remove non-preserved BDDs
+    for (const Ptype& value : globals.values()) {
+        const auto* bdd = std::get_if<Bdd_ptype>(&value);
+        if (bdd == nullptr || !bdd->preserved) continue;
+        std::queue<id_type> to_process;
+        to_process.push(bdd->id);
+        while (!to_process.empty()) {
+            id_type current_id = to_process.front();
+            to_process.pop();
+
+            if (current_id < base_size || preserved_ids.contains(current_id)) {
+                continue;
+            }
+            preserved_ids.insert(current_id);
+
+            if (const Bdd_Node& node = node_of(current_id);
+                node.type == Bdd_Node::Bdd_type::INTERNAL) {
+                to_process.push(node.high);
+                to_process.push(node.low);
             }
-        } else {
-            ++it;  // Skip non-BDD types
         }
     }
+    // Remove non-preserved BDDs, keeping symbolic variables
+    globals.erase_if([](const Ptype& value) {
+        const auto* bdd = std::get_if<Bdd_ptype>(&value);
+        return bdd != nullptr && !bdd->preserved;
+    });
 
     // Now, remove all non-preserved IDs from the maps
     for (auto it = id_to_iter.begin(); it != id_to_iter.end();) {
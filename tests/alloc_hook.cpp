@@ -0,0 +1,37 @@
+// Replaces the global operator new and delete to feed alloc_stats. Linked into
+// the tests and bdd_bench targets when BDD_COUNT_ALLOCATIONS is on.
+//
+// Each block carries a header recording its size, so frees are counted
+// whether or not the sized operator delete is used. The array, nothrow and
+// sized forms all forward to these by default; over-aligned allocations use
+// the library's own aligned forms and are not counted.
+#include <cstdlib>
+#include <new>
+
+#include "../src/alloc_stats.h"
+
+namespace {
+constexpr size_t header_size = alignof(std::max_align_t);
+
+[[maybe_unused]] const bool hook_installed = [] {
+    alloc_stats::hooked = true;
+    return true;
+}();
+}  // namespace
+
+void* operator new(const std::size_t size) {
+    void* block = std::malloc(size + header_size);
+    if (block == nullptr) throw std::bad_alloc();
+    *static_cast<std::size_t*>(block) = size;
+    alloc_stats::record_allocation(size);
+    return static_cast<char*>(block) + header_size;
+}
+
+void operator delete(void* p) noexcept {
+    if (p == nullptr) return;
+    void* block = static_cast<char*>(p) - header_size;
+    alloc_stats::record_free(*static_cast<std::size_t*>(block));
+    std::free(block);
+}
+
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
@@ -0,0 +1,289 @@
+// Standalone benchmark runner: runs named workloads and reports engine
+// metrics as JSON, optionally comparing against a saved baseline report
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <regex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/alloc_stats.h"
+#include "../src/parser.h"
+#include "../src/walker.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "benchmark_generators.h"
+#include "perf_counters.h"
+
+ABSL_FLAG(std::vector<std::string>, workloads, {},
+          "Comma separated workload names to run (default: all).");
+ABSL_FLAG(bool, small, false, "Run the small instances of each family.");
+ABSL_FLAG(bool, list, false, "List the workload names and exit.");
+ABSL_FLAG(int, repetitions, 3, "Runs per workload; the median is reported.");
+ABSL_FLAG(std::optional<std::string>, output, std::nullopt,
+          "Write the JSON report to this file instead of stdout.");
+ABSL_FLAG(std::optional<std::string>, baseline, std::nullopt,
+          "JSON report of a previous run to compare against.");
+ABSL_FLAG(double, threshold, 0.10,
+          "Relative increase in wall time reported as a regression.");
+ABSL_FLAG(std::string, nary_schedule, "in_order",
+          "Order n-ary conjunctions are combined in: in_order, smallest or "
+          "balanced.");
+
+// === Memory ===
+static void reset_peak_rss() {
+    // Writing 5 to clear_refs resets VmHWM on Linux; elsewhere the peak is
+    // for the whole process
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+static long peak_rss_kb() {
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);) {
+        if (line.starts_with("VmHWM:")) return std::atol(line.c_str() + 6);
+    }
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// === Running ===
+struct Bench_Result {
+    std::string name;
+    bool correct{};
+    // Of the median run over repetitions, except for the fastest time and
+    // whether every run was correct
+    double wall_ms{};
+    double wall_ms_min{};
+    long peak_rss_kb{};
+    id_type nodes_created{};
+    size_t live_nodes{};
+    uint64_t cache_hits{};
+    uint64_t cache_misses{};
+    uint64_t allocations{};
+    uint64_t allocated_bytes{};
+    int64_t peak_heap_bytes{};
+    std::optional<Perf_Sample> counters{};
+};
+
+static std::optional<std::vector<stmt>> parse_script(
+    const std::string& script, Ast_Arena& arena) {
+    const auto tokens = scan_to_tokens(script);
+    if (!tokens.has_value()) return std::nullopt;
+    auto statements = parse(*tokens, arena);
+    if (!statements.has_value()) return std::nullopt;
+    return std::move(*statements);
+}
+
+static Bench_Result run_workload(const Bench_Workload& workload,
+                                 const int repetitions,
+                                 const Nary_Schedule schedule,
+                                 Perf_Counters& perf) {
+    std::vector<Bench_Result> runs;
+
+    for (int rep = 0; rep < repetitions; ++rep) {
+        Bench_Result& run = runs.emplace_back();
+        run.name = workload.name;
+        reset_peak_rss();
+        alloc_stats::reset_peak();
+        const Alloc_Snapshot heap_before = alloc_stats::snapshot();
+        const auto start = std::chrono::steady_clock::now();
+
+        // The walker is destroyed inside the timed region, as it would be at
+        // the end of a real session
+        {
+            Walker walker;
+            walker.set_nary_schedule(schedule);
+            Ast_Arena arena;
+            auto script = parse_script(workload.script, arena);
+            auto query =
+                parse_script("is_sat " + workload.query + ";", arena);
+            bool ok = script.has_value() && query.has_value();
+
+            // Hardware counters cover only the walker, not lexing and parsing
+            if (ok) {
+                perf.start();
+                walker.walk_statements(*script);
+                walker.get_output();
+                walker.walk_statements(*query);
+                run.counters = perf.stop();
+            }
+            const std::string answer = walker.get_output();
+            run.correct = ok && answer == (workload.expect_sat
+                                               ? "satisfiable\n"
+                                               : "unsatisfiable\n");
+
+            const Walker_Stats& stats = walker.get_stats();
+            run.nodes_created = walker.get_nodes_created();
+            run.live_nodes = walker.get_live_nodes();
+            run.cache_hits = stats.cache_hits;
+            run.cache_misses = stats.cache_misses;
+        }
+
+        run.wall_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+        const Alloc_Snapshot heap = alloc_stats::snapshot();
+        run.allocations = heap.allocations - heap_before.allocations;
+        run.allocated_bytes = heap.bytes - heap_before.bytes;
+        run.peak_heap_bytes = heap.peak_live_bytes - heap_before.live_bytes;
+        run.peak_rss_kb = peak_rss_kb();
+    }
+
+    // Every metric is that of the median run, so they describe one run
+    std::ranges::sort(runs, {}, &Bench_Result::wall_ms);
+    Bench_Result result = runs[runs.size() / 2];
+    result.wall_ms_min = runs.front().wall_ms;
+    result.correct = std::ranges::all_of(runs, &Bench_Result::correct);
+    return result;
+}
+
+// === Reporting ===
+struct Baseline_Entry {
+    double wall_ms{};
+    uint64_t nodes_created{};
+};
+
+static std::unordered_map<std::string, Baseline_Entry> read_baseline(
+    const std::string& path) {
+    // Reports are written one workload per line, so a line-wise scan of our
+    // own output is enough
+    static const std::regex name_re(R"re("name": "([^"]*)")re");
+    static const std::regex wall_re(R"re("wall_ms": ([0-9.eE+-]+))re");
+    static const std::regex nodes_re(R"re("nodes_created": ([0-9]+))re");
+
+    std::unordered_map<std::string, Baseline_Entry> baseline;
+    std::ifstream f(path);
+    for (std::string line; std::getline(f, line);) {
+        std::smatch name;
+        std::smatch wall;
+        std::smatch nodes;
+        if (std::regex_search(line, name, name_re) &&
+            std::regex_search(line, wall, wall_re) &&
+            std::regex_search(line, nodes, nodes_re)) {
+            baseline[name[1]] = {std::stod(wall[1]), std::stoull(nodes[1])};
+        }
+    }
+    return baseline;
+}
+
+static std::string result_json(const Bench_Result& r) {
+    const uint64_t lookups = r.cache_hits + r.cache_misses;
+    const double hit_rate =
+        lookups == 0 ? 0.0 : static_cast<double>(r.cache_hits) / lookups;
+    std::string json = std::format(
+        R"({{"name": "{}", "correct": {}, "wall_ms": {:.3f}, )"
+        R"("wall_ms_min": {:.3f}, "peak_rss_kb": {}, "nodes_created": {}, )"
+        R"("live_nodes": {}, "cache_hits": {}, "cache_misses": {}, )"
+        R"("cache_hit_rate": {:.4f})",
+        r.name, r.correct, r.wall_ms, r.wall_ms_min, r.peak_rss_kb,
+        r.nodes_created, r.live_nodes, r.cache_hits, r.cache_misses,
+        hit_rate);
+    if (alloc_stats::enabled()) {
+        json += std::format(
+            R"(, "allocations": {}, "allocated_bytes": {}, )"
+            R"("peak_heap_bytes": {})",
+            r.allocations, r.allocated_bytes, r.peak_heap_bytes);
+    }
+
+    if (!r.counters.has_value()) return json + R"(, "perf_counters": false)";
+    const auto& c = *r.counters;
+    const double ipc =
+        c.cycles == 0 ? 0.0 : static_cast<double>(c.instructions) / c.cycles;
+    return json + std::format(
+                      R"(, "perf_counters": true, "cycles": {}, )"
+                      R"("instructions": {}, "ipc": {:.3f}, "llc_misses": {}, )"
+                      R"("branch_misses": {})",
+                      c.cycles, c.instructions, ipc, c.llc_misses,
+                      c.branch_misses);
+}
+
+int main(int argc, char* argv[]) {
+    absl::SetProgramUsageMessage(
+        "Usage: " + std::string(*argv) +
+        " [--workloads a,b] [--small] [--repetitions n] [--output file]"
+        " [--baseline file] [--threshold 0.1] [--nary_schedule order]");
+    absl::ParseCommandLine(argc, argv);
+
+    const auto schedule =
+        parse_nary_schedule(absl::GetFlag(FLAGS_nary_schedule));
+    if (!schedule.has_value()) {
+        std::cerr << "Unknown --nary_schedule: "
+                  << absl::GetFlag(FLAGS_nary_schedule) << '\n';
+        return 1;
+    }
+    const auto& selected = absl::GetFlag(FLAGS_workloads);
+    std::vector<Bench_Workload> workloads;
+    for (auto& w : standard_workloads(!absl::GetFlag(FLAGS_small))) {
+        if (selected.empty() ||
+            std::ranges::find(selected, w.name) != selected.end()) {
+            workloads.push_back(std::move(w));
+        }
+    }
+    if (absl::GetFlag(FLAGS_list)) {
+        for (const auto& w : workloads) std::cout << w.name << '\n';
+        return 0;
+    }
+
+    std::unordered_map<std::string, Baseline_Entry> baseline;
+    if (const auto path = absl::GetFlag(FLAGS_baseline); path.has_value()) {
+        baseline = read_baseline(*path);
+    }
+
+    std::ofstream file;
+    if (const auto path = absl::GetFlag(FLAGS_output); path.has_value()) {
+        file.open(*path);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open output file: " << *path << '\n';
+            return 1;
+        }
+    }
+    std::ostream& out = file.is_open() ? file : std::cout;
+
+    const double threshold = absl::GetFlag(FLAGS_threshold);
+    const int repetitions = std::max(1, absl::GetFlag(FLAGS_repetitions));
+    bool failed = false;
+    Perf_Counters perf;
+    if (!perf.available()) {
+        std::cerr << "Hardware counters unavailable, reporting timing only\n";
+    }
+
+    out << "{\n  \"workloads\": [\n";
+    for (size_t i = 0; i < workloads.size(); ++i) {
+        const Bench_Result r = run_workload(workloads[i], repetitions,
+                                            *schedule, perf);
+        std::string line = result_json(r);
+
+        if (const auto it = baseline.find(r.name); it != baseline.end()) {
+            const auto& [base_wall, base_nodes] = it->second;
+            const bool regressed = r.wall_ms > base_wall * (1 + threshold) ||
+                                   r.nodes_created > base_nodes;
+            line += std::format(
+                R"(, "baseline_wall_ms": {:.3f}, "regression": {})",
+                base_wall, regressed);
+            if (regressed) {
+                std::cerr << std::format(
+                    "REGRESSION {}: {:.3f} ms (baseline {:.3f} ms), {} nodes "
+                    "(baseline {})\n",
+                    r.name, r.wall_ms, base_wall, r.nodes_created, base_nodes);
+                failed = true;
+            }
+        }
+        if (!r.correct) {
+            std::cerr << "WRONG ANSWER " << r.name << '\n';
+            failed = true;
+        }
+        out << "    " << line << '}' << (i + 1 < workloads.size() ? "," : "")
+            << '\n';
+    }
+    out << "  ]\n}\n";
+    return failed ? 1 : 0;
+}
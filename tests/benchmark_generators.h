@@ -0,0 +1,274 @@
+#pragma once
+// Parameterised generators for standard BDD workloads. Each generator emits a
+// script for InterpTester together with a query expression whose
+// satisfiability is known in advance.
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Bench_Workload {
+    std::string name;    // e.g. "queens_6"
+    std::string script;  // statements to feed to the interpreter
+    std::string query;   // expression to check after the script has run
+    bool expect_sat{};   // known satisfiability of the query
+};
+
+namespace bench_detail {
+inline std::string join(const std::vector<std::string>& parts,
+                        const std::string_view sep) {
+    std::string result;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (i > 0) result += sep;
+        result += parts[i];
+    }
+    return result;
+}
+
+// Emits statements computing x * y (n bits each) into the 2n bits
+// {prefix}_acc{n}_{k} using shift-and-add with ripple-carry adders
+inline void emit_multiplier(std::string& script, const std::string& prefix,
+                            const std::string& x, const std::string& y,
+                            const int n) {
+    const int width = 2 * n;
+    for (int k = 0; k < width; ++k) {
+        script += std::format("set {}_acc0_{} = false;\n", prefix, k);
+    }
+    for (int j = 0; j < n; ++j) {
+        script += std::format("set {}_c{}_0 = false;\n", prefix, j);
+        for (int k = 0; k < width; ++k) {
+            const std::string acc = std::format("{}_acc{}_{}", prefix, j, k);
+            const std::string carry = std::format("{}_c{}_{}", prefix, j, k);
+            const std::string row =
+                (k - j >= 0 && k - j < n)
+                    ? std::format("({}{} & {}{})", x, k - j, y, j)
+                    : "false";
+            script += std::format("set {}_acc{}_{} = ({} != {}) != {};\n",
+                                  prefix, j + 1, k, acc, row, carry);
+            script += std::format(
+                "set {}_c{}_{} = ({} & {}) | ({} & ({} != {}));\n", prefix, j,
+                k + 1, acc, row, carry, acc, row);
+        }
+    }
+}
+
+// Plain backtracking search, enough to label small random instances
+inline bool brute_force_sat(const std::vector<std::array<int, 3>>& clauses,
+                            const int num_vars) {
+    std::vector<int> value(num_vars, -1);
+    std::function<bool(int)> search = [&](const int var) -> bool {
+        // A clause is falsified once all of its literals are assigned false
+        for (const auto& clause : clauses) {
+            bool falsified = true;
+            for (const int lit : clause) {
+                const int v = std::abs(lit) - 1;
+                if (value[v] == -1 || value[v] == (lit > 0 ? 1 : 0)) {
+                    falsified = false;
+                    break;
+                }
+            }
+            if (falsified) return false;
+        }
+        if (var == num_vars) return true;
+        for (const int choice : {0, 1}) {
+            value[var] = choice;
+            if (search(var + 1)) return true;
+        }
+        value[var] = -1;
+        return false;
+    };
+    return search(0);
+}
+}  // namespace bench_detail
+
+// n queens on an n x n board: satisfiable iff n == 1 or n >= 4
+inline Bench_Workload queens_workload(const int n) {
+    std::string script = "bvar";
+    for (int r = 0; r < n; ++r) {
+        for (int c = 0; c < n; ++c) script += std::format(" q{}_{}", r, c);
+    }
+    script += ";\nset board = true;\n";
+
+    for (int r = 0; r < n; ++r) {
+        std::vector<std::string> row;
+        for (int c = 0; c < n; ++c) row.push_back(std::format("q{}_{}", r, c));
+        script += std::format("set board = board & ({});\n",
+                              bench_detail::join(row, " | "));
+    }
+    for (int r = 0; r < n; ++r) {
+        for (int c = 0; c < n; ++c) {
+            // Cells attacked by (r, c) that come later in row-major order
+            std::vector<std::string> attacked;
+            for (int r2 = r; r2 < n; ++r2) {
+                for (int c2 = 0; c2 < n; ++c2) {
+                    if (r2 == r && c2 <= c) continue;
+                    if (r2 == r || c2 == c || r2 - r == c2 - c ||
+                        r2 - r == c - c2) {
+                        attacked.push_back(std::format("q{}_{}", r2, c2));
+                    }
+                }
+            }
+            if (attacked.empty()) continue;
+            script += std::format("set board = board & (q{}_{} -> !({}));\n",
+                                  r, c, bench_detail::join(attacked, " | "));
+        }
+    }
+    return {std::format("queens_{}", n), std::move(script), "board",
+            n == 1 || n >= 4};
+}
+
+// Miter of two n-bit adders (ripple-carry and majority-carry formulations),
+// which is unsatisfiable since the adders are equivalent
+inline Bench_Workload adder_workload(const int bits) {
+    std::string script = "bvar";
+    for (int i = 0; i < bits; ++i) script += std::format(" a{} b{}", i, i);
+    script += ";\nset c0 = false;\nset d0 = false;\nset miter = false;\n";
+
+    for (int i = 0; i < bits; ++i) {
+        script += std::format("set s{0} = (a{0} != b{0}) != c{0};\n", i);
+        script += std::format(
+            "set c{1} = (a{0} & b{0}) | (c{0} & (a{0} != b{0}));\n", i, i + 1);
+        script += std::format(
+            "set d{1} = (a{0} & b{0}) | (a{0} & d{0}) | (b{0} & d{0});\n", i,
+            i + 1);
+        script += std::format(
+            "set t{0} = ((a{0} | b{0} | d{0}) & !d{1}) | (a{0} & b{0} & "
+            "d{0});\n",
+            i, i + 1);
+        script += std::format("set miter = miter | (s{0} != t{0});\n", i);
+    }
+    script += std::format("set miter = miter | (c{0} != d{0});\n", bits);
+    return {std::format("adder_{}", bits), std::move(script), "miter", false};
+}
+
+// Miter of a * b against b * a over every output bit of an n-bit array
+// multiplier; the middle output bits are exponential for any ordering
+inline Bench_Workload multiplier_workload(const int bits) {
+    std::string script = "bvar";
+    for (int i = 0; i < bits; ++i) script += std::format(" a{} b{}", i, i);
+    script += ";\n";
+    bench_detail::emit_multiplier(script, "ab", "a", "b", bits);
+    bench_detail::emit_multiplier(script, "ba", "b", "a", bits);
+
+    script += "set miter = false;\n";
+    for (int k = 0; k < 2 * bits; ++k) {
+        script += std::format("set miter = miter | (ab_acc{0}_{1} != "
+                              "ba_acc{0}_{1});\n",
+                              bits, k);
+    }
+    return {std::format("multiplier_{}", bits), std::move(script), "miter",
+            false};
+}
+
+// holes + 1 pigeons in holes holes, which is unsatisfiable
+inline Bench_Workload pigeonhole_workload(const int holes) {
+    const int pigeons = holes + 1;
+    std::string script = "bvar";
+    for (int p = 0; p < pigeons; ++p) {
+        for (int h = 0; h < holes; ++h) script += std::format(" p{}_{}", p, h);
+    }
+    script += ";\nset php = true;\n";
+
+    for (int p = 0; p < pigeons; ++p) {
+        std::vector<std::string> somewhere;
+        for (int h = 0; h < holes; ++h) {
+            somewhere.push_back(std::format("p{}_{}", p, h));
+        }
+        script += std::format("set php = php & ({});\n",
+                              bench_detail::join(somewhere, " | "));
+    }
+    for (int h = 0; h < holes; ++h) {
+        for (int p = 0; p < pigeons; ++p) {
+            for (int q = p + 1; q < pigeons; ++q) {
+                script += std::format("set php = php & !(p{}_{} & p{}_{});\n",
+                                      p, h, q, h);
+            }
+        }
+    }
+    return {std::format("pigeonhole_{}", holes), std::move(script), "php",
+            false};
+}
+
+// Random 3-CNF with a clause/variable ratio of 4.26, near the phase
+// transition. The expected answer is found by a backtracking search, so keep
+// num_vars small enough for that to be quick. With as_and_all the clauses
+// are conjoined by a single and_all, whose order is up to --nary_schedule,
+// instead of one at a time.
+inline Bench_Workload random_3cnf_workload(const int num_vars,
+                                           const uint32_t seed,
+                                           const bool as_and_all = false) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pick_var(1, num_vars);
+    std::bernoulli_distribution pick_sign;
+    const int num_clauses = static_cast<int>(num_vars * 4.26 + 0.5);
+
+    std::vector<std::array<int, 3>> clauses;
+    for (int i = 0; i < num_clauses; ++i) {
+        std::array<int, 3> clause{};
+        for (int j = 0; j < 3; ++j) {
+            int v = 0;
+            do {
+                v = pick_var(rng);
+            } while (std::ranges::find(clause, v) != clause.end() ||
+                     std::ranges::find(clause, -v) != clause.end());
+            clause[j] = pick_sign(rng) ? v : -v;
+        }
+        clauses.push_back(clause);
+    }
+
+    std::string script = "bvar";
+    for (int v = 1; v <= num_vars; ++v) script += std::format(" v{}", v);
+    script += ";\n";
+    std::vector<std::string> terms;
+    for (const auto& clause : clauses) {
+        std::vector<std::string> lits;
+        for (const int lit : clause) {
+            lits.push_back(std::format("{}v{}", lit < 0 ? "!" : "",
+                                       std::abs(lit)));
+        }
+        terms.push_back(std::format("({})", bench_detail::join(lits, " | ")));
+    }
+    if (as_and_all) {
+        script += std::format("set cnf = and_all({});\n",
+                              bench_detail::join(terms, ", "));
+    } else {
+        script += "set cnf = true;\n";
+        for (const auto& term : terms) {
+            script += std::format("set cnf = cnf & {};\n", term);
+        }
+    }
+    return {std::format("random_3cnf_{}{}_{}", as_and_all ? "and_all_" : "",
+                        num_vars, seed),
+            std::move(script), "cnf",
+            bench_detail::brute_force_sat(clauses, num_vars)};
+}
+
+// The standard suite at three increasing sizes per family
+inline std::vector<Bench_Workload> standard_workloads(const bool large) {
+    using sizes = std::array<int, 3>;
+    std::vector<Bench_Workload> workloads;
+    for (const int n : large ? sizes{6, 7, 8} : sizes{3, 4, 5}) {
+        workloads.push_back(queens_workload(n));
+    }
+    for (const int n : large ? sizes{16, 32, 64} : sizes{2, 4, 8}) {
+        workloads.push_back(adder_workload(n));
+    }
+    for (const int n : large ? sizes{5, 6, 7} : sizes{2, 3, 4}) {
+        workloads.push_back(multiplier_workload(n));
+    }
+    for (const int n : large ? sizes{6, 7, 8} : sizes{2, 3, 4}) {
+        workloads.push_back(pigeonhole_workload(n));
+    }
+    for (const int n : large ? sizes{20, 25, 30} : sizes{8, 10, 12}) {
+        workloads.push_back(random_3cnf_workload(n, 2024));
+    }
+    for (const int n : large ? sizes{20, 25, 30} : sizes{8, 10, 12}) {
+        workloads.push_back(random_3cnf_workload(n, 2024, true));
+    }
+    return workloads;
+}
@@ -1,8 +1,12 @@
 #include <format>
+#include <iostream>
 
 #include "catch2/benchmark/catch_benchmark.hpp"
 #include "catch2/catch_test_macros.hpp"
+#include "../src/alloc_stats.h"
+#include "benchmark_generators.h"
 #include "interp_tester.h"
+#include "perf_counters.h"
 
 TEST_CASE("Benchmark Assignments", "[!benchmark]") {
     BENCHMARK("var0 & ... & var4") {
@@ -35,3 +39,78 @@ TEST_CASE("Benchmark Assignments", "[!benchmark]") {
         interp.feed("set c = a | b;");
     };
 }
+
+TEST_CASE("Benchmark Suite Answers") {
+    // The small instances of every family, checked against known answers
+    for (const auto& workload : standard_workloads(false)) {
+        INFO(workload.name);
+        InterpTester interp;
+        interp.feed(workload.script);
+        REQUIRE(interp.is_sat(workload.query) == workload.expect_sat);
+    }
+}
+
+TEST_CASE("Hardware Counters") {
+    // Counters may be unavailable here, in which case timing is all we get
+    Perf_Counters perf;
+    perf.start();
+    InterpTester interp;
+    interp.feed(queens_workload(4).script);
+    const auto sample = perf.stop();
+    REQUIRE(sample.has_value() == perf.available());
+    if (sample.has_value()) {
+        REQUIRE(sample->instructions > 0);
+        REQUIRE(sample->cycles > 0);
+    }
+}
+
+TEST_CASE("Benchmark Suite Counters", "[!benchmark]") {
+    // Cycles, instructions and misses for one run of each workload, next to
+    // the timings of "Benchmark Suite"
+    Perf_Counters perf;
+    if (!perf.available()) SKIP("hardware counters unavailable");
+    for (const auto& workload : standard_workloads(true)) {
+        InterpTester interp;
+        perf.start();
+        interp.feed(workload.script);
+        interp.is_sat(workload.query);
+        const auto c = perf.stop();
+        REQUIRE(c.has_value());
+        std::cout << std::format(
+            "{:<20} {:>14} cycles {:>14} instructions {:>10} LLC misses "
+            "{:>10} branch misses\n",
+            workload.name, c->cycles, c->instructions, c->llc_misses,
+            c->branch_misses);
+    }
+}
+
+TEST_CASE("Benchmark Suite Allocations", "[!benchmark]") {
+    // Heap traffic of one run of each workload, to compare before and after
+    // changes that remove allocations
+    if (!alloc_stats::enabled()) SKIP("built without BDD_COUNT_ALLOCATIONS");
+    for (const auto& workload : standard_workloads(true)) {
+        alloc_stats::reset_peak();
+        const Alloc_Snapshot before = alloc_stats::snapshot();
+        {
+            InterpTester interp;
+            interp.feed(workload.script);
+            interp.is_sat(workload.query);
+        }
+        const Alloc_Snapshot after = alloc_stats::snapshot();
+        std::cout << std::format(
+            "{:<20} {:>12} allocations {:>14} bytes {:>12} peak live bytes\n",
+            workload.name, after.allocations - before.allocations,
+            after.bytes - before.bytes,
+            after.peak_live_bytes - before.live_bytes);
+    }
+}
+
+TEST_CASE("Benchmark Suite", "[!benchmark]") {
+    for (const auto& workload : standard_workloads(true)) {
+        BENCHMARK(workload.name.c_str()) {
+            InterpTester interp;
+            interp.feed(workload.script);
+            return interp.is_sat(workload.query);
+        };
+    }
+}
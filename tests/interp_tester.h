@@ -9,7 +9,8 @@ class InterpTester {
     void feed(const std::string& input) {
         const auto tokens = scan_to_tokens(input);
         assert(tokens.has_value());  // no lexer error in interpreter tester
-        auto estmts = parse(*tokens);
+        Ast_Arena arena;
+        auto estmts = parse(*tokens, arena);
         assert(estmts.has_value());  // no parser error in interpreter tester
 
         walker.walk_statements(*estmts);
@@ -20,11 +21,25 @@ class InterpTester {
         const auto tokens = scan_to_tokens(input);
         assert(tokens.has_value());  // no lexer error in interpreter tester
         const_span sp(*tokens);
-        const auto ptr_expr = parse_expr(sp);
+        Ast_Arena arena;
+        const auto ptr_expr = parse_expr(sp, arena);
         const auto bdd_id = walker.construct_bdd(*ptr_expr);
+        walker.expr_to_id_memo.clear();  // the arena is freed on return
         return bdd_id;
     }
 
+    // The program construct_bdd would run for input, whose sources are freed
+    Bytecode lower_expr(std::string input) {
+        input.push_back(';');
+        const auto tokens = scan_to_tokens(input);
+        assert(tokens.has_value());
+        const_span sp(*tokens);
+        Ast_Arena arena;
+        Bytecode program;
+        walker.lower(*parse_expr(sp, arena), program);
+        return program;
+    }
+
     std::string expr_tree_repr(std::string input) {
         return walker.bdd_repr(interpret_expr(std::move(input)));
     }
@@ -37,6 +52,18 @@ class InterpTester {
         return error;
     }
 
+    const Walker& get_walker() const { return walker; }
+    void map_snapshot(const std::string& path) { walker.map_snapshot(path); }
+    void set_source_all_or_nothing(const bool enabled) {
+        walker.set_source_all_or_nothing(enabled);
+    }
+    void set_statement_threads(const size_t n) {
+        walker.set_statement_threads(n);
+    }
+    void set_nary_schedule(const Nary_Schedule schedule) {
+        walker.set_nary_schedule(schedule);
+    }
+
     bool is_sat(std::string input) {
         return walker.is_sat(interpret_expr(std::move(input)));
     }
@@ -5,6 +5,7 @@
 class LexerParserTester {
     std::ostringstream parser_error_stream{};
     std::ostringstream lexer_error_stream{};
+    Ast_Arena arena{};  // owns the expressions of every statement fed
 
    public:
     LexerParserTester() = default;
@@ -16,7 +17,7 @@ class LexerParserTester {
             lexer_error_stream << tokens.error().what() << '\n';
             return {};
         }
-        parse_result_t estmts = parse(*tokens);
+        parse_result_t estmts = parse(*tokens, arena);
         if (!estmts.has_value()) {
             for (const auto& error : estmts.error()) {
                 parser_error_stream << error.what() << '\n';
@@ -0,0 +1,105 @@
+#pragma once
+// Hardware performance counters for benchmarks, read through Linux
+// perf_event_open. When the counters cannot be opened (non-Linux, restrictive
+// perf_event_paranoid, containers without the syscall) available() is false
+// and the benchmarks fall back to timing only.
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+struct Perf_Sample {
+    uint64_t cycles{};
+    uint64_t instructions{};
+    uint64_t llc_misses{};
+    uint64_t branch_misses{};
+};
+
+class Perf_Counters {
+    static constexpr size_t num_events = 4;
+    std::array<int, num_events> fds{-1, -1, -1, -1};
+
+#ifdef __linux__
+    static int open_event(const uint32_t type, const uint64_t config,
+                          const int group_fd) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = group_fd == -1;  // the leader starts the whole group
+        attr.exclude_kernel = 1;         // allowed with perf_event_paranoid 2
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        return static_cast<int>(
+            syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+    }
+#endif
+
+   public:
+    Perf_Counters() {
+#ifdef __linux__
+        // One group, so all four counters cover exactly the same instructions
+        constexpr std::array<std::pair<uint32_t, uint64_t>, num_events> events{{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        }};
+        for (size_t i = 0; i < num_events; ++i) {
+            fds[i] = open_event(events[i].first, events[i].second, fds[0]);
+            if (fds[i] == -1) {
+                close_all();
+                return;
+            }
+        }
+#endif
+    }
+    ~Perf_Counters() { close_all(); }
+    Perf_Counters(const Perf_Counters&) = delete;
+    Perf_Counters& operator=(const Perf_Counters&) = delete;
+
+    bool available() const { return fds[0] != -1; }
+
+    void start() {
+#ifdef __linux__
+        if (!available()) return;
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    // Stops counting and returns the counts since start()
+    std::optional<Perf_Sample> stop() {
+#ifdef __linux__
+        if (!available()) return std::nullopt;
+        ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // PERF_FORMAT_GROUP layout: the number of events, then their values
+        std::array<uint64_t, num_events + 1> values{};
+        if (read(fds[0], values.data(), sizeof(values)) !=
+                static_cast<ssize_t>(sizeof(values)) ||
+            values[0] != num_events) {
+            return std::nullopt;
+        }
+        return Perf_Sample{values[1], values[2], values[3], values[4]};
+#else
+        return std::nullopt;
+#endif
+    }
+
+   private:
+    void close_all() {
+#ifdef __linux__
+        for (int& fd : fds) {
+            if (fd != -1) close(fd);
+            fd = -1;
+        }
+#endif
+    }
+};
@@ -0,0 +1,104 @@
+#include <cmath>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "../src/bdd.h"
+#include "../src/engine_exceptions.h"
+
+TEST_CASE("Library Handles") {
+    Manager m;
+    const Bdd x = m.var(0);
+    const Bdd y = m.var(1);
+    const Bdd z = m.var(2);
+
+    SECTION("Variables") {
+        REQUIRE(m.num_vars() == 3);
+        REQUIRE(m.var(1) == y);
+        REQUIRE(m.var("v2") == z);
+        REQUIRE(m.var(5) != z);
+        REQUIRE(m.num_vars() == 6);
+        const Bdd named = m.var("carry");
+        REQUIRE(m.num_vars() == 7);
+        REQUIRE(named == m.var(6));
+    }
+
+    SECTION("Levels skip names already in use") {
+        const Bdd v4 = m.var("v4");  // level 3
+        const Bdd v5 = m.var(5);
+        REQUIRE(m.num_vars() == 6);
+        REQUIRE(m.var("v4") == v4);
+        REQUIRE(m.var(3) == v4);
+        REQUIRE(m.var(5) == v5);
+        REQUIRE(m.var("v6") == v5);
+    }
+
+    SECTION("Operators") {
+        REQUIRE((x & !x).is_false());
+        REQUIRE((x | !x).is_true());
+        REQUIRE((!!x) == x);
+        REQUIRE((x ^ y) == ((x & !y) | (!x & y)));
+        REQUIRE((x ^ x).is_false());
+        REQUIRE((x & (y | z)) == ((x & y) | (x & z)));
+        Bdd acc = m.constant(true);
+        acc &= x;
+        acc |= y;
+        acc ^= z;
+        REQUIRE(acc == ((x | y) ^ z));
+    }
+
+    SECTION("Quantifiers") {
+        const Bdd f = (x & y) | (!x & z);
+        REQUIRE(f.exists({x}) == (y | z));
+        REQUIRE(f.forall({x}) == (y & z));
+        REQUIRE(f.exists({x, y, z}).is_true());
+        REQUIRE(f.forall({z, x}) == (x & y).forall({x}));
+        // Variables below the top of the body but absent from a branch
+        const Bdd w = m.var(3);
+        REQUIRE(((x & y) | (!x & w)).exists({y, w}).is_true());
+        REQUIRE(f.exists({}) == f);
+    }
+
+    SECTION("Composition") {
+        const Bdd f = (x & y) | z;
+        REQUIRE(f.compose(x, m.constant(true)) == (y | z));
+        REQUIRE(f.compose(y, !x) == z);
+        REQUIRE(f.compose(z, x & y) == (x & y));
+        REQUIRE(x.compose(x, !x) == !x);
+        REQUIRE_THROWS_AS(f.compose(x & y, z), ExecutionException);
+        REQUIRE_THROWS_AS(f.compose(!x, z), ExecutionException);
+    }
+
+    SECTION("Counting") {
+        REQUIRE(m.constant(true).sat_count() == 8);
+        REQUIRE(m.constant(false).sat_count() == 0);
+        REQUIRE(x.sat_count() == 4);
+        REQUIRE((x & y).sat_count() == 2);
+        REQUIRE((x ^ y ^ z).sat_count() == 4);
+        REQUIRE((x & y & z).size() == 5);
+    }
+
+    SECTION("Handles of different managers do not mix") {
+        Manager other;
+        const Bdd a = other.var(0);
+        REQUIRE(a.id() == x.id());
+        REQUIRE(a != x);
+        REQUIRE_THROWS_AS(a & x, ExecutionException);
+        REQUIRE_THROWS_AS((x & y).exists({a}), ExecutionException);
+    }
+}
+
+TEST_CASE("Library Scale") {
+    // An n-bit equality comparator has 3n + 2 nodes with interleaved bits
+    Manager m;
+    constexpr uint32_t n = 64;
+    Bdd equal = m.constant(true);
+    for (uint32_t i = 0; i < n; ++i) {
+        equal &= !(m.var(2 * i) ^ m.var(2 * i + 1));
+    }
+    REQUIRE(equal.size() == 3 * n + 2);
+    REQUIRE(equal.sat_count() == std::ldexp(1.0, n));
+
+    std::vector<Bdd> evens;
+    for (uint32_t i = 0; i < n; ++i) evens.push_back(m.var(2 * i));
+    REQUIRE(equal.exists(evens).is_true());
+}
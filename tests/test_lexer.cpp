@@ -1,3 +1,5 @@
+#include <memory>
+#include <string>
 #include <variant>
 #include <vector>
 
@@ -31,4 +33,45 @@ TEST_CASE("Lex Invalid") {
         std::string error = lexer_parser_tester.get_lexer_error();
         REQUIRE(absl::StrContains(error, "LexerException"));
     }
-}
\ No newline at end of file
+
+    SECTION("Unterminated String") {
+        lexer_parser_tester.feed("save \"out.bddsnap;\n");
+        std::string error = lexer_parser_tester.get_lexer_error();
+        REQUIRE(absl::StrContains(error, "Unterminated string"));
+    }
+}
+
+TEST_CASE("Lex Strings") {
+    const auto tokens = scan_to_tokens(R"(save "dir/my file.bddsnap";)");
+    REQUIRE(tokens.has_value());
+    REQUIRE(tokens->size() == 3);
+    REQUIRE((*tokens)[1].type == token::Type::STRING);
+    REQUIRE((*tokens)[1].lexeme == "dir/my file.bddsnap");
+}
+TEST_CASE("Lex Interned Names") {
+    auto source = std::make_unique<std::string>("set alpha = alpha_1 & 42;");
+    const auto first = scan_to_tokens(*source);
+    REQUIRE(first.has_value());
+    source.reset();  // names never point into the source
+
+    const auto second = scan_to_tokens("alpha | alpha_1;");
+    REQUIRE(second.has_value());
+    const token& a = (*first)[1];
+    const token& b = (*second)[0];
+    REQUIRE(a.lexeme == "alpha");
+    REQUIRE(a.symbol == b.symbol);
+    REQUIRE(a.lexeme.data() == b.lexeme.data());  // stored once
+    REQUIRE((*first)[3].symbol == (*second)[2].symbol);
+    REQUIRE(a.symbol != (*first)[3].symbol);
+    REQUIRE((*first)[5].token_value == 42);
+    REQUIRE(Symbol_Table::instance().name(a.symbol) == "alpha");
+}
+
+TEST_CASE("Lex Numbers And Strings Without Interning") {
+    const size_t interned = Symbol_Table::instance().size();
+    const auto tokens = scan_to_tokens(R"(load "run_7781.bddsnap"; 99123;)");
+    REQUIRE(tokens.has_value());
+    REQUIRE((*tokens)[1].lexeme == "run_7781.bddsnap");
+    REQUIRE((*tokens)[3].lexeme == "99123");
+    REQUIRE(Symbol_Table::instance().size() == interned);
+}
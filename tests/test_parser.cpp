@@ -1,10 +1,15 @@
 
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 #include <variant>
 #include <vector>
 
 #include "absl/strings/match.h"
 #include "absl/strings/str_split.h"
 #include "catch2/catch_test_macros.hpp"
+#include "../src/parse_pipeline.h"
 #include "parser_tester.h"
 
 TEST_CASE("Parse Valid") {
@@ -16,7 +21,8 @@ TEST_CASE("Parse Valid") {
         display_tree a;
     )";
 
-    std::vector<stmt> statements = LexerParserTester().feed(input);
+    LexerParserTester parser_tester;  // owns the parsed expressions
+    std::vector<stmt> statements = parser_tester.feed(input);
     REQUIRE(statements.size() == 5);
     REQUIRE(std::holds_alternative<decl_stmt>(statements[0]));
     REQUIRE(std::holds_alternative<assign_stmt>(statements[1]));
@@ -105,6 +111,30 @@ TEST_CASE("Invalid Declaration") {
         REQUIRE(absl::StrContains(error, "ParserException"));
     }
 
+    SECTION("Display limit without a number") {
+        parser_tester.feed("display_graph x limit y;");
+        std::string error = parser_tester.get_parser_error();
+        REQUIRE(absl::StrContains(error, "Expected a number after 'limit'"));
+    }
+
+    SECTION("Missing final semicolon") {
+        parser_tester.feed("bvar x; set a = x");
+        std::string error = parser_tester.get_parser_error();
+        REQUIRE(absl::StrContains(error, "Expected ';' at the end"));
+    }
+
+    SECTION("Unclosed parenthesis") {
+        parser_tester.feed("bvar x; set a = (x;");
+        std::string error = parser_tester.get_parser_error();
+        REQUIRE(absl::StrContains(error, "Expected ')' after expression"));
+    }
+
+    SECTION("Import without as") {
+        parser_tester.feed("load_cnf \"f.cnf\" f;");
+        std::string error = parser_tester.get_parser_error();
+        REQUIRE(absl::StrContains(error, "Expected 'as' after file name"));
+    }
+
     SECTION("Multiple errors detected at once") {
         std::string input = R"(
             bvar x, y, z;
@@ -120,4 +150,149 @@ TEST_CASE("Invalid Declaration") {
             REQUIRE(absl::StrContains(line, "ParserException"));
         }
     }
-}
\ No newline at end of file
+}
+TEST_CASE("Parse Into Arena") {
+    const auto tokens = scan_to_tokens("set a = x & !y; is_sat a | z;");
+    REQUIRE(tokens.has_value());
+    Ast_Arena arena;
+    const auto statements = parse(*tokens, arena);
+    REQUIRE(statements.has_value());
+
+    // x, y, !y, x & !y, a, z and a | z
+    REQUIRE(arena.size() == 7);
+    REQUIRE(stmt_repr((*statements)[0]) ==
+            "Assign_Stmt(Target: Identifier(a), Value: BinExpr(Identifier(x), "
+            "&, UnaExpr(!, Identifier(y))))");
+
+    // Nodes are freed together and the arena can be reused
+    arena.clear();
+    REQUIRE(arena.size() == 0);
+    const auto again = parse(*tokens, arena);
+    REQUIRE(again.has_value());
+    REQUIRE(arena.size() == 7);
+}
+
+TEST_CASE("Hash-Consed Expressions") {
+    const auto tokens =
+        scan_to_tokens("is_sat (x & y) | !(x & y); is_sat y & x; x & y;");
+    REQUIRE(tokens.has_value());
+    Ast_Arena arena;
+    const auto statements = parse(*tokens, arena);
+    REQUIRE(statements.has_value());
+
+    // x, y, x & y, !(x & y), the disjunction and y & x: the repeated x & y is
+    // a single node, shared by the first and last statements
+    REQUIRE(arena.size() == 6);
+    const auto& first = std::get<func_call_stmt>((*statements)[0]);
+    const auto& last = std::get<expr_stmt>((*statements)[2]);
+    REQUIRE(std::get<bin_expr>(*first.arguments[0]).left == last.expression);
+
+    // p == q shares p and q between its two conjunctions
+    arena.clear();
+    const auto equality = scan_to_tokens("x == y;");
+    REQUIRE(equality.has_value());
+    REQUIRE(parse(*equality, arena).has_value());
+    REQUIRE(arena.size() == 7);
+}
+
+TEST_CASE("Literals Outlive Their Source") {
+    auto source = std::make_unique<std::string>(
+        R"(load "a.bddsnap"; load "a.bddsnap"; 42 | 042;)");
+    const auto tokens = scan_to_tokens(*source);
+    REQUIRE(tokens.has_value());
+    Ast_Arena arena;
+    const auto statements = parse(*tokens, arena);
+    REQUIRE(statements.has_value());
+    source.reset();
+
+    // Strings are new nodes, equal numbers are one node
+    REQUIRE(arena.size() == 4);
+    REQUIRE(stmt_summary((*statements)[1]) == "load \"a.bddsnap\"");
+    const auto& number = std::get<expr_stmt>((*statements)[2]);
+    const auto& disjunction = std::get<bin_expr>(*number.expression);
+    REQUIRE(disjunction.left == disjunction.right);
+    REQUIRE(std::get<literal>(*disjunction.left).value.lexeme == "42");
+}
+
+TEST_CASE("N-ary Expressions") {
+    LexerParserTester parser_tester;
+    const auto statements = parser_tester.feed(
+        "and_all(x, y | z, !x); or_all(); is_sat or_all(x);");
+    REQUIRE(statements.size() == 3);
+    REQUIRE(stmt_repr(statements[0]) ==
+            "Expr_Stmt(NaryExpr(&, Identifier(x), BinExpr(Identifier(y), |, "
+            "Identifier(z)), UnaExpr(!, Identifier(x))))");
+    REQUIRE(std::get<nary_expr>(
+                *std::get<expr_stmt>(statements[1]).expression)
+                .operands.empty());
+
+    parser_tester.feed("and_all x, y;");
+    REQUIRE(absl::StrContains(parser_tester.get_parser_error(),
+                              "Expected '(' after n-ary operator"));
+    parser_tester.feed("or_all(x y);");
+    REQUIRE(absl::StrContains(parser_tester.get_parser_error(),
+                              "Expected ',' or ')' after operand"));
+}
+
+TEST_CASE("Parse Pipeline") {
+    std::string script = "bvar x y;";
+    for (int i = 0; i < 1000; ++i) script += "set a = x & y;";
+
+    SECTION("Batches arrive in order") {
+        std::istringstream is(script);
+        Parse_Pipeline pipeline(is);
+        size_t count = 0;
+        while (const auto batch = pipeline.next()) {
+            REQUIRE(batch->error.empty());
+            REQUIRE(batch->statements.size() <=
+                    Parse_Pipeline::batch_statements);
+            if (count == 0) {
+                REQUIRE(std::holds_alternative<decl_stmt>(
+                    batch->statements.front()));
+            }
+            count += batch->statements.size();
+        }
+        REQUIRE(count == 1001);
+    }
+
+    SECTION("A parse error ends the script") {
+        std::istringstream is(script + "set b = ;" + script);
+        Parse_Pipeline pipeline(is);
+        size_t count = 0;
+        std::string error;
+        while (const auto batch = pipeline.next()) {
+            count += batch->statements.size();
+            error += batch->error;
+        }
+        REQUIRE(count == 1001);
+        REQUIRE(absl::StrContains(error, "ParserException"));
+    }
+
+    SECTION("Read errors end the script") {
+        // A stream that fails once its contents have been read, rethrowing
+        // the error
+        struct Failing_Buf : std::stringbuf {
+            using std::stringbuf::stringbuf;
+            int_type underflow() override {
+                throw std::runtime_error("disk on fire");
+            }
+        };
+        for (const bool background : {true, false}) {
+            Failing_Buf buf("bvar x y; set a = x & y;");
+            std::istream is(&buf);
+            is.exceptions(std::ios::badbit);
+            Parse_Pipeline pipeline(is, background);
+            std::string error;
+            while (const auto batch = pipeline.next()) error += batch->error;
+            REQUIRE(absl::StrContains(error, "disk on fire"));
+        }
+    }
+
+    SECTION("Stopping early") {
+        std::istringstream is(script + script + script + script);
+        Parse_Pipeline pipeline(is);
+        REQUIRE(pipeline.next().has_value());
+        // The destructor stops the producer, which may be blocked on the
+        // full queue
+    }
+}
@@ -1,10 +1,26 @@
 
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <format>
 #include <fstream>
+#include <memory>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include "absl/strings/match.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_split.h"
 #include "catch2/catch_test_macros.hpp"
+#include "../src/alloc_stats.h"
+#include "../src/batch.h"
+#include "../src/engine_exceptions.h"
+#include "../src/schedule.h"
+#include "../src/server.h"
+#include "../src/trace.h"
 #include "interp_tester.h"
 
 TEST_CASE("Assignments and Usage") {
@@ -224,6 +240,507 @@ TEST_CASE("Constructing Expression with Quantifiers") {
     }
 }
 
+TEST_CASE("Shared Subexpressions") {
+    InterpTester interp;
+
+    SECTION("Shared nodes are evaluated once") {
+        // Every == repeats both of its operands, so the tree doubles in size
+        // with each level while the hash-consed DAG only grows by a few nodes
+        std::string vars = "bvar x0";
+        std::string formula = "x0";
+        for (int i = 1; i <= 40; ++i) {
+            vars += std::format(" x{}", i);
+            formula = std::format("({} == x{})", formula, i);
+        }
+        interp.feed(vars + ";");
+        interp.feed("set p = " + formula + ";");
+        REQUIRE(absl::StrContains(interp.get_output(), "Assigned to p"));
+        REQUIRE(interp.is_sat("p"));
+        REQUIRE(interp.is_sat("!p"));
+    }
+
+    SECTION("Rebinding a name invalidates nodes that use it") {
+        interp.feed("bvar x y z;");
+        interp.feed("set a = x; set b = a & y; set a = z; set c = a & y;");
+        REQUIRE(interp.interpret_expr("b == (x & y)") == 1);
+        REQUIRE(interp.interpret_expr("c == (z & y)") == 1);
+    }
+
+    SECTION("Swept names are no longer found") {
+        interp.feed("bvar x y;");
+        interp.feed("set a = x & y; set b = a; sweep; set c = a;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Variable not found: a"));
+    }
+}
+
+TEST_CASE("Binding Environment") {
+    Environment env;
+    const symbol_id x = intern("env_x").id;
+    const symbol_id f = intern("env_f").id;
+    const symbol_id g = intern("env_g").id;
+    env.bind(x, Bvar_ptype{"env_x", 0});
+    env.bind(f, Bdd_ptype{"env_f", 5});
+    REQUIRE(env.size() == 2);
+    REQUIRE(std::holds_alternative<Bvar_ptype>(*env.find(x)));
+    REQUIRE(std::get<Bdd_ptype>(*env.find(f)).id == 5);
+    REQUIRE_FALSE(env.contains(g));
+    REQUIRE_FALSE(env.contains(g + 1000));
+
+    SECTION("Rebinding replaces the value in place") {
+        const Ptype* slot = env.find(f);
+        env.bind(f, Bdd_ptype{"env_f", 7});
+        REQUIRE(env.find(f) == slot);
+        REQUIRE(std::get<Bdd_ptype>(*slot).id == 7);
+        REQUIRE(env.size() == 2);
+    }
+
+    SECTION("Erasing") {
+        env.bind(g, Bdd_ptype{"env_g", 6, true});
+        env.erase_if([](const Ptype& value) {
+            const auto* bdd = std::get_if<Bdd_ptype>(&value);
+            return bdd != nullptr && !bdd->preserved;
+        });
+        REQUIRE(env.size() == 2);
+        REQUIRE_FALSE(env.contains(f));
+        env.erase(g);
+        env.erase(g);
+        REQUIRE(env.size() == 1);
+        size_t values = 0;
+        for (const Ptype& value : env.values()) {
+            REQUIRE(std::holds_alternative<Bvar_ptype>(value));
+            ++values;
+        }
+        REQUIRE(values == 1);
+    }
+
+    SECTION("Values come in the order names were first bound") {
+        env.bind(g, Bdd_ptype{"env_g", 6});
+        env.erase(x);
+        env.bind(x, Bvar_ptype{"env_x", 1});
+        std::vector<std::string_view> names;
+        for (const Ptype& value : env.values()) {
+            names.push_back(std::visit([](const auto& v) { return v.name; },
+                                       value));
+        }
+        REQUIRE(names == std::vector<std::string_view>{"env_x", "env_f",
+                                                       "env_g"});
+    }
+}
+
+TEST_CASE("Expression Bytecode") {
+    InterpTester interp;
+    interp.feed("bvar x y; set a = x & y;");
+    interp.get_output();
+    using Op = Bc_Instr::Op;
+    const auto ops_of = [](const Bytecode& program) {
+        std::vector<Op> ops;
+        for (const auto& instr : program.code) ops.push_back(instr.op);
+        return ops;
+    };
+
+    SECTION("One instruction per distinct node, children first") {
+        const Bytecode program = interp.lower_expr("(x & !y) | (y & !x)");
+        REQUIRE(ops_of(program) == std::vector{Op::VAR, Op::VAR, Op::NOT,
+                                               Op::AND, Op::NOT, Op::AND,
+                                               Op::OR});
+        REQUIRE(program.operands ==
+                std::vector<uint32_t>{0, 2, 1, 4, 3, 5});
+        REQUIRE(program.code[6].a == 4);
+        REQUIRE(program.code[6].b == 2);
+        REQUIRE(program.result == 6);
+    }
+
+    SECTION("Names are resolved while lowering") {
+        const id_type a = interp.interpret_expr("x & y");
+        const Bytecode program = interp.lower_expr("exists (y) (a | x)");
+        REQUIRE(ops_of(program) ==
+                std::vector{Op::CONST, Op::VAR, Op::OR, Op::EXISTS});
+        REQUIRE(program.code[0].a == a);
+        REQUIRE(program.code[1].a == 0);
+        REQUIRE(program.levels == std::vector<uint32_t>{1});
+    }
+
+    SECTION("Errors are raised when their instruction is reached") {
+        const Bytecode program = interp.lower_expr("(x | y) & missing");
+        REQUIRE(ops_of(program) ==
+                std::vector{Op::VAR, Op::VAR, Op::OR, Op::FAIL, Op::AND});
+        const id_type created = interp.get_walker().get_nodes_created();
+        interp.feed("set b = (x | y) & missing;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Variable not found: missing"));
+        // x | y was built before the error, as by a recursive walk
+        REQUIRE(interp.get_walker().get_nodes_created() == created + 1);
+        interp.interpret_expr("x | y");
+        REQUIRE(interp.get_walker().get_nodes_created() == created + 1);
+    }
+
+    SECTION("Node ids are checked when reached") {
+        // The node with this id is created by the left operand
+        InterpTester other;
+        other.feed("bvar x y; set a = x & y;");
+        const id_type next = other.interpret_expr("x & !y");
+        REQUIRE(ops_of(interp.lower_expr(std::format("{} & x", next))) ==
+                std::vector{Op::ID, Op::VAR, Op::AND});
+        REQUIRE(interp.interpret_expr(std::format("(x & !y) | {}", next)) ==
+                next);
+        interp.feed(std::format("set b = {} | x;", next + 100));
+        REQUIRE(absl::StrContains(interp.get_output(), "ID not found"));
+    }
+}
+
+TEST_CASE("Expression Simplification") {
+    InterpTester interp;
+    interp.feed("bvar x y z; set t = true;");
+    interp.get_output();
+    using Op = Bc_Instr::Op;
+    const auto ops_of = [&interp](const std::string& input) {
+        std::vector<Op> ops;
+        for (const auto& instr : interp.lower_expr(input).code) {
+            ops.push_back(instr.op);
+        }
+        return ops;
+    };
+    const std::vector just_var{Op::VAR};
+
+    SECTION("Constants are folded") {
+        REQUIRE(ops_of("x & true & !false") == just_var);
+        REQUIRE(ops_of("(y & false) | x") == just_var);
+        REQUIRE(ops_of("x & t") == just_var);  // names bound to constants
+        REQUIRE(ops_of("exists (x) true") == std::vector{Op::CONST});
+        REQUIRE(interp.interpret_expr("x | !false") == 1);
+    }
+
+    SECTION("Double negations cancel") {
+        REQUIRE(ops_of("!!x") == just_var);
+        REQUIRE(ops_of("!!!x") == std::vector{Op::VAR, Op::NOT});
+    }
+
+    SECTION("Repeated and complementary operands") {
+        REQUIRE(ops_of("x & x") == just_var);
+        REQUIRE(ops_of("(x | y) & (x | y)") ==
+                std::vector{Op::VAR, Op::VAR, Op::OR});
+        REQUIRE(ops_of("y & x & !y") == std::vector{Op::CONST});
+        REQUIRE(interp.interpret_expr("(x | y) & !(x | y)") == 0);
+        REQUIRE(interp.interpret_expr("x | z | !x") == 1);
+    }
+
+    SECTION("Absorption") {
+        REQUIRE(ops_of("x & (x | y)") == just_var);
+        REQUIRE(ops_of("(y & z & x) | x") == just_var);
+        REQUIRE(interp.interpret_expr("(x | (x & y)) == x") == 1);
+    }
+
+    SECTION("Chains become one instruction") {
+        const Bytecode program =
+            interp.lower_expr("((x & y) & (z & x)) & !(y | z)");
+        REQUIRE(program.code.back().op == Op::AND);
+        REQUIRE(program.code.back().b == 4);
+        REQUIRE(interp.interpret_expr("x & y & z & !(y | z)") == 0);
+    }
+
+    SECTION("Long chains are flattened in linear time") {
+        constexpr int terms = 100000;
+        std::string declaration = "bvar";
+        std::string chain;
+        for (int i = 0; i < terms; ++i) {
+            declaration += " v" + std::to_string(i);
+            chain += (i == 0 ? "v" : " | v") + std::to_string(i);
+        }
+        interp.feed(declaration + ";");
+        const Bytecode program = interp.lower_expr(chain);
+        REQUIRE(program.code.size() == terms + 1);
+        REQUIRE(program.code.back().op == Op::OR);
+        REQUIRE(program.code.back().b == terms);
+    }
+
+    SECTION("Negations are pushed into negated operands") {
+        REQUIRE(ops_of("!(!x & !y)") ==
+                std::vector{Op::VAR, Op::VAR, Op::OR});
+        REQUIRE(ops_of("!(exists (x) !(x & y))") ==
+                std::vector{Op::VAR, Op::VAR, Op::AND, Op::FORALL});
+        REQUIRE(interp.interpret_expr("!(!x | !y) == (x & y)") == 1);
+        REQUIRE(interp.interpret_expr(
+                    "!(forall (x) !(x | y)) == exists (x) (x | y)") == 1);
+    }
+
+    SECTION("Errors survive simplification") {
+        interp.feed("set b = missing & false;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Variable not found: missing"));
+        interp.feed("set b = x | true | \"file\";");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Strings can only be used as file names"));
+    }
+}
+
+TEST_CASE("N-ary Operations") {
+    InterpTester interp;
+    std::string vars = "bvar";
+    for (int i = 0; i < 12; ++i) vars += std::format(" x{}", i);
+    interp.feed(vars + "; bvar y z;");
+
+    SECTION("Builtins") {
+        REQUIRE(interp.interpret_expr("and_all(y, z, !y | z) == (y & z)") ==
+                1);
+        REQUIRE(interp.interpret_expr("or_all(y, z) == (y | z)") == 1);
+        REQUIRE(interp.interpret_expr("and_all()") == 1);
+        REQUIRE(interp.interpret_expr("or_all()") == 0);
+        REQUIRE(interp.interpret_expr("and_all(y, z & !y, x0)") == 0);
+        REQUIRE(interp.interpret_expr("or_all(y, !(y & z), x0)") == 1);
+        REQUIRE(interp.interpret_expr("and_all(y)") ==
+                interp.interpret_expr("y"));
+        interp.feed("set f = and_all(y, missing);");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Variable not found: missing"));
+    }
+
+    SECTION("Every schedule gives the same BDD") {
+        // A ring of clauses and of cubes, with the same as chains
+        std::string clauses;
+        std::string chain;
+        std::string cubes;
+        std::string or_chain;
+        for (int i = 0; i < 12; ++i) {
+            const std::string sep = i == 0 ? "" : ", ";
+            const std::string clause =
+                std::format("(x{} | !x{})", i, (i + 5) % 12);
+            const std::string cube =
+                std::format("(x{} & !x{})", i, (i + 5) % 12);
+            clauses += sep + clause;
+            chain += (i == 0 ? "" : " & ") + clause;
+            cubes += sep + cube;
+            or_chain += (i == 0 ? "" : " | ") + cube;
+        }
+        std::vector<id_type> results;
+        for (const auto schedule :
+             {Nary_Schedule::IN_ORDER, Nary_Schedule::SMALLEST_FIRST,
+              Nary_Schedule::BALANCED}) {
+            interp.set_nary_schedule(schedule);
+            results.push_back(
+                interp.interpret_expr("and_all(" + clauses + ")"));
+            REQUIRE(interp.interpret_expr(chain) == results.back());
+            REQUIRE(interp.interpret_expr("or_all(" + cubes + ")") ==
+                    interp.interpret_expr(or_chain));
+        }
+        REQUIRE(results[0] == results[1]);
+        REQUIRE(results[1] == results[2]);
+        REQUIRE(results[0] > 1);
+    }
+
+    SECTION("The default order creates the nodes of pairwise evaluation") {
+        InterpTester pairwise;
+        pairwise.feed(vars + "; bvar y z;");
+        pairwise.feed("set a = x3 | y; set b = a & !x7; set c = b & z;");
+        const id_type c = pairwise.interpret_expr("c");
+        REQUIRE(interp.interpret_expr("(x3 | y) & !x7 & z") == c);
+        REQUIRE(interp.get_walker().get_nodes_created() ==
+                pairwise.get_walker().get_nodes_created());
+    }
+
+    SECTION("Schedule names") {
+        REQUIRE(parse_nary_schedule("smallest") ==
+                Nary_Schedule::SMALLEST_FIRST);
+        REQUIRE(parse_nary_schedule("balanced") == Nary_Schedule::BALANCED);
+        REQUIRE(parse_nary_schedule("in_order") == Nary_Schedule::IN_ORDER);
+        REQUIRE_FALSE(parse_nary_schedule("largest").has_value());
+    }
+}
+
+TEST_CASE("Server Mode") {
+    const std::string path = "test_server.sock";
+    Walker walker;
+    Server server(walker, path);
+    std::jthread serving([&] { server.run(); });
+    struct Stop_On_Exit {  // before serving is joined, even if a check fails
+        Server& server;
+        ~Stop_On_Exit() { server.stop(); }
+    } stop_on_exit{server};
+
+    const auto connect_client = [&] {
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::ranges::copy(path, address.sun_path);
+        REQUIRE(connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                        sizeof(address)) == 0);
+        return fd;
+    };
+    const auto ask = [](const int fd, const std::string& script) {
+        REQUIRE(write_frame(fd, script));
+        const auto response = read_frame(fd);
+        REQUIRE(response.has_value());
+        return *response;
+    };
+
+    const int first = connect_client();
+    const int second = connect_client();
+
+    SECTION("State persists across requests and clients") {
+        const std::string declared = ask(first, "bvar x y; set p = x & y;");
+        REQUIRE(absl::StartsWith(declared, "0Declared Symbolic Variable: x"));
+        REQUIRE(absl::StrContains(declared, "Assigned to p"));
+        const std::string used = ask(second, "set q = p | x; is_sat(q);");
+        REQUIRE(absl::StartsWith(used, "0Assigned to q"));
+    }
+
+    SECTION("Errors are reported in the status") {
+        const std::string failed = ask(first, "set r = missing; bvar z;");
+        REQUIRE(absl::StartsWith(failed, "1"));
+        REQUIRE(absl::StrContains(failed, "Variable not found: missing"));
+        REQUIRE_FALSE(absl::StrContains(failed, "\033["));  // no colours
+        REQUIRE_FALSE(absl::StrContains(failed, "Declared"));
+        REQUIRE(absl::StartsWith(ask(first, "set r = true;"), "0"));
+        REQUIRE(absl::StartsWith(ask(first, "set ;"), "1"));
+    }
+
+    SECTION("Pipelined requests are answered in order") {
+        for (int i = 0; i < 5; ++i) {
+            REQUIRE(write_frame(first, std::format("set s{} = true;", i)));
+        }
+        for (int i = 0; i < 5; ++i) {
+            REQUIRE(absl::StrContains(*read_frame(first),
+                                      std::format("Assigned to s{}", i)));
+        }
+    }
+
+    SECTION("A client that stops reading does not hold up others") {
+        // Far more output than the socket buffers hold, never read
+        for (int i = 0; i < 8; ++i) {
+            std::string script = "bvar";
+            for (int j = 0; j < 4000; ++j) {
+                script += std::format(" v{}_{}", i, j);
+            }
+            REQUIRE(write_frame(first, script + ";"));
+        }
+        const timeval timeout{.tv_sec = 10, .tv_usec = 0};
+        setsockopt(second, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                   sizeof(timeout));
+        // Fails until all of the first client's requests have run
+        std::string response;
+        for (int tries = 0; tries < 100 && !response.starts_with("0");
+             ++tries) {
+            response = ask(second, "set q = v7_3999;");
+        }
+        REQUIRE(absl::StartsWith(response, "0Assigned to q"));
+    }
+
+    close(first);
+    close(second);
+}
+
+TEST_CASE("Dependency Waves") {
+    // Waves of a script made only of assignments
+    const auto waves_of = [](const std::string& script) {
+        const auto tokens = scan_to_tokens(script);
+        Ast_Arena arena;
+        const auto statements = parse(*tokens, arena);
+        std::vector<Stmt_Access> accesses;
+        for (const auto& statement : *statements) {
+            accesses.push_back(*access_of(std::get<assign_stmt>(statement)));
+        }
+        return schedule_waves(accesses);
+    };
+
+    SECTION("Independent assignments share a wave") {
+        REQUIRE(waves_of("set a = x & y; set b = x | y; set c = !x;") ==
+                std::vector<uint32_t>{0, 0, 0});
+    }
+
+    SECTION("Read after write") {
+        REQUIRE(waves_of("set a = x; set b = a & y; set c = b | a;") ==
+                std::vector<uint32_t>{0, 1, 2});
+    }
+
+    SECTION("Write after read and write after write") {
+        REQUIRE(waves_of("set b = a & y; set a = x; set a = z;") ==
+                std::vector<uint32_t>{0, 1, 2});
+    }
+
+    SECTION("Names in substitutions and quantifiers are read") {
+        REQUIRE(waves_of("set a = x; set b = sub {y: a} (y & z);"
+                         "set c = exists x a;") ==
+                std::vector<uint32_t>{0, 1, 1});
+    }
+
+    SECTION("Node ids cannot be scheduled") {
+        const auto tokens = scan_to_tokens("set a = x & 2;");
+        Ast_Arena arena;
+        const auto statements = parse(*tokens, arena);
+        REQUIRE_FALSE(
+            access_of(std::get<assign_stmt>((*statements)[0])).has_value());
+    }
+}
+
+TEST_CASE("Concurrent Assignments") {
+    InterpTester interp;
+    interp.set_statement_threads(4);
+    interp.feed("bvar x y z;");
+    interp.get_output();
+
+    SECTION("Output is in program order") {
+        std::string script;
+        std::string expected;
+        for (int i = 0; i < 50; ++i) {
+            script += std::format("set s{} = {};", i,
+                                  i % 2 == 0 ? "x & (y | z)" : "x != (y == z)");
+            expected += std::format("Assigned to s{} with", i);
+        }
+        interp.feed(script);
+        const std::string output = interp.get_output();
+        std::istringstream lines(output);
+        std::string names;
+        for (std::string line; std::getline(lines, line);) {
+            names += line.substr(0, line.find(" BDD ID"));
+        }
+        REQUIRE(names == expected);
+        REQUIRE(interp.interpret_expr("s0 == (x & (y | z))") == 1);
+        REQUIRE(interp.interpret_expr("s49 == (x != (y == z))") == 1);
+    }
+
+    SECTION("Results do not depend on timing") {
+        const std::string script =
+            "set a = x & y; set b = y | z; set c = a != b; set d = !c & x;"
+            "set e = sub {z: y} (x & z); set f = exists y c; set a = d | e;";
+        interp.feed(script);
+        const std::string first = interp.get_output();
+        for (int run = 0; run < 5; ++run) {
+            InterpTester other;
+            other.set_statement_threads(4);
+            other.feed("bvar x y z;");
+            other.get_output();
+            other.feed(script);
+            REQUIRE(other.get_output() == first);
+        }
+        REQUIRE(interp.interpret_expr("c == ((x & y) != (y | z))") == 1);
+        REQUIRE(interp.interpret_expr("a == ((!c & x) | (x & y))") == 1);
+    }
+
+    SECTION("Later bindings are undone after an error") {
+        interp.feed("set a = x; set b = a & y;");
+        interp.get_output();
+        interp.feed("set a = y; set c = missing; set d = z; set b = z;");
+        const std::string output = interp.get_output();
+        REQUIRE(absl::StrContains(output, "Assigned to a"));
+        REQUIRE(absl::StrContains(output, "Variable not found: missing"));
+        REQUIRE_FALSE(absl::StrContains(output, "Assigned to d"));
+        REQUIRE(interp.interpret_expr("a == y") == 1);
+        REQUIRE(interp.interpret_expr("b == (x & y)") == 1);
+        interp.feed("set e = d;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Variable not found: d"));
+    }
+
+    SECTION("Other statements run in order between runs") {
+        interp.feed("set a = x; set b = y; bvar w; set c = a & w; set d = b;"
+                    "set w = x;");
+        const std::string output = interp.get_output();
+        REQUIRE(absl::StrContains(output, "Declared Symbolic Variable: w"));
+        REQUIRE(absl::StrContains(output, "Variable name conflict"));
+        REQUIRE(interp.interpret_expr("c == (x & w)") == 1);
+    }
+}
+
 TEST_CASE("Satisfiability Tests") {
     InterpTester interp;
     interp.feed("bvar x y z;");
@@ -277,6 +794,13 @@ TEST_CASE("Satisfiability Tests") {
         REQUIRE(interp.is_sat("!(x & false)") == true);
         REQUIRE(interp.is_sat("!(x | true)") == false);
     }
+
+    SECTION("Satisfiability After Clearing Caches") {
+        interp.feed("set a = x & y; clear_cache;");
+        REQUIRE(interp.is_sat("a") == true);
+        interp.feed("sweep;");
+        REQUIRE(interp.is_sat("x & !x") == false);
+    }
 }
 
 TEST_CASE("Assignment Errors") {
@@ -365,6 +889,117 @@ TEST_CASE("Source Function") {
         interp.feed("source nonexistent_file.txt;");
         REQUIRE(absl::StrContains(interp.get_output(), "Failed to open file"));
     }
+
+    SECTION("Statements Run Until a Parse Error") {
+        std::ofstream("test_source_code.txt")
+            << "bvar x y;\nset a = x & y;\nset b = x &;\nset c = x;\n";
+        interp.feed("source test_source_code.txt;");
+        const std::string output = interp.get_output();
+        REQUIRE(absl::StrContains(output, "Assigned to a"));
+        REQUIRE(absl::StrContains(output, "ParserException"));
+        REQUIRE_FALSE(absl::StrContains(output, "Assigned to c"));
+        std::remove("test_source_code.txt");
+    }
+
+    SECTION("All or Nothing") {
+        std::ofstream("test_source_code.txt")
+            << "bvar x y;\nset a = x & y;\nset b = x &;\nset c = x;\n";
+        interp.set_source_all_or_nothing(true);
+        interp.feed("source test_source_code.txt;");
+        const std::string output = interp.get_output();
+        REQUIRE(absl::StrContains(output, "ParserException"));
+        REQUIRE_FALSE(absl::StrContains(output, "Assigned to a"));
+        std::remove("test_source_code.txt");
+    }
+
+    SECTION("Statements Across Chunks") {
+        // Longer than a chunk, with a ';' inside a string and no ';' after
+        // the last statement
+        std::ofstream f("test_source_code.txt");
+        f << "bvar x y;\n";
+        for (int i = 0; i < 4000; ++i) {
+            f << std::format("set s{} = x & y;\n", i);
+        }
+        f << "load_cnf \"no;such.cnf\" as f;\nset t = x";
+        f.close();
+        interp.feed("source test_source_code.txt;");
+        const std::string output = interp.get_output();
+        REQUIRE(absl::StrContains(output, "Assigned to s3999"));
+        REQUIRE(absl::StrContains(output, "Failed to open file: no;such.cnf"));
+        REQUIRE_FALSE(absl::StrContains(output, "Assigned to t"));
+        std::remove("test_source_code.txt");
+    }
+}
+
+TEST_CASE("Batch Mode") {
+    namespace fs = std::filesystem;
+    const fs::path dir = "test_batch";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    const auto write_script = [&](const std::string& name,
+                                  const std::string& script) {
+        std::ofstream(dir / name) << script;
+    };
+    // The same names in every script, which must not see each other
+    for (int i = 0; i < 6; ++i) {
+        write_script(std::format("prop{}.bdd", i),
+                     std::format("bvar x y; set a = x & y; set b = a | {};",
+                                 i % 2 == 0 ? "x" : "y"));
+    }
+    write_script("broken.bdd", "bvar x; set a = missing; set b = x;");
+    write_script("notes.txt", "not a script");
+    const auto read_output = [&](const std::string& name) {
+        std::ifstream f(dir / "out" / name);
+        return std::string{std::istreambuf_iterator(f), {}};
+    };
+
+    Batch_Options options;
+    options.dir = dir;
+    options.output_dir = dir / "out";
+    options.jobs = 3;
+    const auto results = run_batch(options);
+    REQUIRE(results.size() == 7);
+    REQUIRE(results[0].script.filename() == "broken.bdd");
+    REQUIRE_FALSE(results[0].completed);
+    for (size_t i = 1; i < results.size(); ++i) {
+        REQUIRE(results[i].completed);
+        REQUIRE(results[i].peak_nodes >= 4);
+    }
+
+    REQUIRE(absl::StrContains(read_output("broken.bdd.out"),
+                              "Variable not found: missing"));
+    REQUIRE_FALSE(absl::StrContains(read_output("broken.bdd.out"), "\033["));
+    REQUIRE_FALSE(absl::StrContains(read_output("broken.bdd.out"),
+                                    "Assigned to b"));
+    // Every script starts from an empty session, so ids repeat
+    REQUIRE(read_output("prop0.bdd.out") == read_output("prop2.bdd.out"));
+    REQUIRE(absl::StrContains(read_output("prop1.bdd.out"),
+                              "Declared Symbolic Variable: x"));
+    REQUIRE_FALSE(fs::exists(dir / "out" / "notes.txt.out"));
+
+    std::ostringstream summary;
+    write_batch_summary(summary, results, std::chrono::milliseconds(1));
+    REQUIRE(absl::StartsWith(summary.str(),
+                             "Batch: 7 scripts, 1 failed, 1.000 ms\n"));
+    REQUIRE(absl::StrContains(summary.str(), "failed  broken.bdd"));
+
+    // Walker settings apply to every script: the statements before a parse
+    // error past the first batch only run when streaming
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    std::string late_error;
+    for (int i = 0; i < 300; ++i) late_error += std::format("bvar v{};", i);
+    write_script("late_error.bdd", late_error + "set ;");
+    REQUIRE_FALSE(run_batch(options)[0].completed);
+    REQUIRE(absl::StrContains(read_output("late_error.bdd.out"), "Declared"));
+    options.source_all_or_nothing = true;
+    REQUIRE_FALSE(run_batch(options)[0].completed);
+    REQUIRE_FALSE(
+        absl::StrContains(read_output("late_error.bdd.out"), "Declared"));
+
+    options.dir = dir / "missing";
+    REQUIRE_THROWS_AS(run_batch(options), ExecutionException);
+    fs::remove_all(dir);
 }
 
 TEST_CASE("Clear Cache Function") {
@@ -617,4 +1252,583 @@ TEST_CASE("Using IDs as Expressions") {
         interp.feed("x & 100;");
         REQUIRE(absl::StrContains(interp.get_output(), "ExecutionException"));
     }
-}
\ No newline at end of file
+}
+TEST_CASE("Profiling") {
+    InterpTester interp;
+    interp.feed("profile_on; bvar x y z; set a = x & y; set b = a | z;");
+    interp.get_output();
+
+    SECTION("Report Lists Statements") {
+        interp.feed("profile_report;");
+        const std::string report = interp.get_output();
+        REQUIRE(absl::StrContains(report, "Profile: 3 statements"));
+        REQUIRE(absl::StrContains(report, "set a"));
+        REQUIRE(absl::StrContains(report, "set b"));
+        REQUIRE(absl::StrContains(report, "bvar x y z"));
+    }
+
+    SECTION("Report Respects Top N") {
+        interp.feed("profile_report 1;");
+        const std::vector<std::string> lines =
+            absl::StrSplit(interp.get_output(), '\n', absl::SkipEmpty());
+        REQUIRE(lines.size() == 3);  // summary, header and one statement
+    }
+
+    SECTION("CSV Output") {
+        interp.feed("profile_csv test_profile.csv;");
+        std::ifstream f("test_profile.csv");
+        std::string header;
+        std::getline(f, header);
+        REQUIRE(absl::StartsWith(header, "index,statement,wall_ns"));
+        std::string line;
+        size_t rows = 0;
+        while (std::getline(f, line)) ++rows;
+        REQUIRE(rows == 3);
+        f.close();
+        std::remove("test_profile.csv");
+    }
+
+    SECTION("CSV Quotes Are Doubled") {
+        interp.feed("load \"no_such_file.bddsnap\";");
+        interp.feed("profile_csv test_profile.csv;");
+        std::ifstream f("test_profile.csv");
+        const std::string csv{std::istreambuf_iterator(f), {}};
+        REQUIRE(absl::StrContains(csv, R"(,"load ""no_such_file.bddsnap""",)"));
+        f.close();
+        std::remove("test_profile.csv");
+    }
+
+    SECTION("Profiling Can Be Disabled") {
+        interp.feed("profile_off; set c = a & b; profile_report;");
+        REQUIRE(
+            absl::StrContains(interp.get_output(), "Profile: 4 statements"));
+    }
+}
+
+TEST_CASE("Graph Display") {
+    InterpTester interp;
+    interp.feed("bvar x y z; set a = x & y | z;");
+    interp.get_output();
+
+    SECTION("Level Order With Ranks") {
+        interp.feed("display_graph a;");
+        const std::string output = interp.get_output();
+        REQUIRE(output.starts_with("digraph G {\n  subgraph level_0 {\n"));
+        REQUIRE(output.ends_with("}\n"));
+        REQUIRE(output.find("level_0") < output.find("level_1"));
+        REQUIRE(output.find("level_1") < output.find("level_2"));
+        REQUIRE(output.find("level_2") < output.find("terminals"));
+        REQUIRE(absl::StrContains(output, "[label=\"TRUE\"]"));
+        REQUIRE(!absl::StrContains(output, "..."));
+    }
+
+    SECTION("Node Limit") {
+        interp.feed("display_graph a limit 2;");
+        const std::string output = interp.get_output();
+        REQUIRE(absl::StrContains(output, "[label=\"x\"]"));
+        REQUIRE(absl::StrContains(output, "[label=\"y\"]"));
+        REQUIRE(!absl::StrContains(output, "[label=\"z\"]"));
+        // The z node, reached from both written nodes, and TRUE
+        REQUIRE(absl::StrContains(output, "[label=\"...\", shape=none]"));
+        REQUIRE(std::ranges::count(output, '.') == 6);
+    }
+
+    SECTION("To A File") {
+        interp.feed("display_graph a to \"test_graph.dot\";");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Wrote graph of 5 nodes to test_graph.dot"));
+        std::ifstream f("test_graph.dot");
+        const std::string contents{std::istreambuf_iterator(f), {}};
+        interp.feed("display_graph a;");
+        REQUIRE(contents == interp.get_output());
+
+        interp.feed("display_graph a to test_graph.dot limit 1;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Wrote graph of 1 nodes"));
+        std::remove("test_graph.dot");
+
+        interp.feed("display_graph a to \"no_such_dir/graph.dot\";");
+        REQUIRE(absl::StrContains(interp.get_output(), "Failed to open file"));
+    }
+}
+
+TEST_CASE("DAG Display") {
+    InterpTester interp;
+    interp.feed("bvar x y z; set a = x & y | z;");
+    interp.get_output();
+    const id_type a = interp.interpret_expr("a");
+    const id_type y_or_z = interp.interpret_expr("y | z");
+    const id_type z = interp.interpret_expr("z");
+
+    SECTION("Each Node Once, Children First") {
+        interp.feed("display_dag a;");
+        // The z node is shared by both branches but defined once
+        REQUIRE(interp.get_output() ==
+                std::format("n1 = true\n"
+                            "n0 = false\n"
+                            "n{2} = z ? n1 : n0\n"
+                            "n{1} = y ? n1 : n{2}\n"
+                            "n{0} = x ? n{1} : n{2}\n",
+                            a, y_or_z, z));
+    }
+
+    SECTION("To A File With A Limit") {
+        interp.feed("display_dag a to \"test_dag.txt\" limit 3;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Wrote DAG of 3 nodes to test_dag.txt"));
+        std::ifstream f("test_dag.txt");
+        const std::string contents{std::istreambuf_iterator(f), {}};
+        REQUIRE(contents == std::format("n1 = true\nn0 = false\n"
+                                        "n{} = z ? n1 : n0\n",
+                                        z));
+        std::remove("test_dag.txt");
+    }
+
+    SECTION("Linear In The Size Of The BDD") {
+        // 2^20 paths to true but only 62 nodes
+        std::string formula = "true";
+        std::string decl = "bvar";
+        for (int i = 0; i < 20; ++i) {
+            decl += std::format(" p{} q{}", i, i);
+            formula = std::format("({} & (p{} != q{}))", formula, i, i);
+        }
+        interp.feed(decl + ";");
+        interp.get_output();
+        interp.feed("display_dag " + formula + ";");
+        const std::string output = interp.get_output();
+        REQUIRE(std::ranges::count(output, '\n') == 2 + 3 * 20);
+    }
+}
+
+TEST_CASE("Snapshots") {
+    InterpTester interp;
+    interp.feed("bvar x y z; set a = x & y; set b = a | z; set c = !b;");
+    interp.feed("preserve a; save \"test_snapshot.bddsnap\";");
+    REQUIRE(absl::StrContains(interp.get_output(),
+                              "Saved 9 nodes, 3 variables and 3 bindings"));
+
+    SECTION("Round Trip") {
+        InterpTester loaded;
+        loaded.feed("bvar w; set d = w; load \"test_snapshot.bddsnap\";");
+        REQUIRE(absl::StrContains(loaded.get_output(), "Loaded 9 nodes"));
+        for (const auto* name : {"a", "b", "c"}) {
+            REQUIRE(loaded.expr_tree_repr(name) == interp.expr_tree_repr(name));
+        }
+        REQUIRE(loaded.is_sat("b & !(x & y | z)") == false);
+
+        // The previous session is gone
+        loaded.feed("d;");
+        REQUIRE(absl::StrContains(loaded.get_output(), "Variable not found"));
+    }
+
+    SECTION("Preserved Flags Survive") {
+        InterpTester loaded;
+        loaded.feed("load \"test_snapshot.bddsnap\"; sweep; a; b;");
+        const std::string output = loaded.get_output();
+        REQUIRE(absl::StrContains(output, "BDD ID:"));
+        REQUIRE(absl::StrContains(output, "Variable not found: b"));
+    }
+
+    SECTION("New Work After Load") {
+        InterpTester loaded;
+        loaded.feed("load \"test_snapshot.bddsnap\"; set e = a & !c;");
+        REQUIRE(loaded.expr_tree_repr("e") == loaded.expr_tree_repr("a"));
+    }
+
+    SECTION("Saving Twice Gives Identical Files") {
+        interp.feed("save \"test_snapshot2.bddsnap\";");
+        const auto read_file = [](const std::string& path) {
+            std::ifstream f(path, std::ios::binary);
+            return std::string{std::istreambuf_iterator(f), {}};
+        };
+        const std::string first = read_file("test_snapshot.bddsnap");
+        REQUIRE(first == read_file("test_snapshot2.bddsnap"));
+        // The padding after each node's type is zero
+        for (size_t node = 0; node < 11; ++node) {
+            REQUIRE(first.substr(24 + node * 16 + 1, 3) ==
+                    std::string(3, '\0'));
+        }
+        std::remove("test_snapshot2.bddsnap");
+    }
+
+    SECTION("Corrupt Snapshots Are Rejected") {
+        {
+            std::ofstream f("test_snapshot.bddsnap",
+                            std::ios::binary | std::ios::in);
+            f.seekp(24 + 2 * 16 + 8);  // high child of node 2
+            f.put('\x7f');
+        }
+        InterpTester loaded;
+        loaded.feed("set keep = true; load \"test_snapshot.bddsnap\";");
+        REQUIRE(absl::StrContains(loaded.get_output(), "Malformed node 2"));
+        REQUIRE(loaded.is_sat("keep"));
+
+        loaded.feed("load \"no_such_file.bddsnap\";");
+        REQUIRE(absl::StrContains(loaded.get_output(), "Failed to open file"));
+    }
+
+    SECTION("Strings Are Not Expressions") {
+        interp.feed("set d = \"x\";");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Strings can only be used as file names"));
+    }
+    std::remove("test_snapshot.bddsnap");
+}
+
+TEST_CASE("Mapped Snapshots") {
+    InterpTester interp;
+    interp.feed("bvar x y z; set a = x & y; set b = a | z; preserve a b;");
+    interp.feed("save \"test_mapped.bddsnap\";");
+    interp.get_output();
+
+    InterpTester mapped;
+    mapped.map_snapshot("test_mapped.bddsnap");
+    REQUIRE(absl::StrContains(mapped.get_output(), "Mapped 6 nodes"));
+    REQUIRE(mapped.get_walker().get_live_nodes() == 8);
+    REQUIRE(mapped.expr_tree_repr("b") == interp.expr_tree_repr("b"));
+
+    SECTION("Rebuilt Nodes Come From The Base") {
+        // x & y is in the snapshot, so no new node is created
+        REQUIRE(mapped.interpret_expr("x & y") == mapped.interpret_expr("a"));
+        REQUIRE(mapped.get_walker().get_nodes_created() == 0);
+    }
+
+    SECTION("New Nodes Go Into The Overlay") {
+        mapped.feed("set c = a & !z;");
+        REQUIRE(mapped.get_walker().get_nodes_created() > 0);
+        REQUIRE(mapped.is_sat("c & b"));
+        REQUIRE(!mapped.is_sat("c & z"));
+
+        mapped.feed("sweep; set d = b;");
+        REQUIRE(mapped.get_walker().get_live_nodes() == 8);
+        REQUIRE(mapped.expr_tree_repr("d") == interp.expr_tree_repr("b"));
+    }
+
+    SECTION("Saving A Mapped Session") {
+        mapped.feed("set c = a & !z; save \"test_mapped2.bddsnap\";");
+        InterpTester loaded;
+        loaded.feed("load \"test_mapped2.bddsnap\";");
+        REQUIRE(loaded.expr_tree_repr("c") == mapped.expr_tree_repr("c"));
+        REQUIRE(loaded.expr_tree_repr("b") == interp.expr_tree_repr("b"));
+        std::remove("test_mapped2.bddsnap");
+    }
+
+    SECTION("Saving Over The Mapped File") {
+        // The file is replaced, so the mapping keeps the old contents
+        mapped.feed("set c = a & !z; save \"test_mapped.bddsnap\";");
+        REQUIRE(mapped.expr_tree_repr("b") == interp.expr_tree_repr("b"));
+        REQUIRE(!std::ifstream("test_mapped.bddsnap.tmp").is_open());
+        InterpTester loaded;
+        loaded.feed("load \"test_mapped.bddsnap\";");
+        REQUIRE(loaded.expr_tree_repr("c") == mapped.expr_tree_repr("c"));
+    }
+
+    SECTION("Bad Files") {
+        InterpTester other;
+        REQUIRE_THROWS_AS(other.map_snapshot("no_such_file.bddsnap"),
+                          ExecutionException);
+        std::ofstream("test_not_snapshot.bddsnap") << "bvar x;";
+        REQUIRE_THROWS_AS(other.map_snapshot("test_not_snapshot.bddsnap"),
+                          ExecutionException);
+        std::remove("test_not_snapshot.bddsnap");
+
+        {
+            std::ofstream f("test_mapped.bddsnap",
+                            std::ios::binary | std::ios::in);
+            f.seekp(24 + 3 * 16 + 8);  // high child of node 3, y in a
+            f.put('\x7f');
+        }
+        // Nodes are only checked when they are read
+        other.map_snapshot("test_mapped.bddsnap");
+        REQUIRE(absl::StrContains(other.get_output(), "Mapped 6 nodes"));
+        other.feed("display_tree a;");
+        REQUIRE(absl::StrContains(other.get_output(),
+                                  "Malformed node 3 in snapshot"));
+    }
+    std::remove("test_mapped.bddsnap");
+}
+
+TEST_CASE("CNF Import") {
+    InterpTester interp;
+
+    SECTION("Clauses") {
+        // Clauses may span lines, share lines and repeat literals
+        std::ofstream("test_import.cnf") << "c a small formula\n"
+                                            "p cnf 3 4\n"
+                                            "1 -2 0 2 3\n"
+                                            "3 0\n"
+                                            "-1 -1 -3 0\n"
+                                            "1 -1 2 0\n";
+        interp.feed("load_cnf \"test_import.cnf\" as f;");
+        const std::string output = interp.get_output();
+        REQUIRE(absl::StrContains(
+            output, "Loaded 4 clauses over 3 variables from test_import.cnf"));
+        REQUIRE(absl::StrContains(output, "Assigned to f with BDD ID:"));
+        REQUIRE(interp.expr_tree_repr("f") ==
+                interp.expr_tree_repr("(v1 | !v2) & (v2 | v3) & (!v1 | !v3)"));
+    }
+
+    SECTION("Existing Variables Keep Their Order") {
+        std::ofstream("test_import.cnf") << "p cnf 2 1\n1 2 0\n";
+        interp.feed("bvar v2 x; load_cnf test_import.cnf as f; set g = f;");
+        REQUIRE(interp.expr_tree_repr("f") == interp.expr_tree_repr("v1 | v2"));
+        REQUIRE(interp.is_sat("f & !v1"));
+    }
+
+    SECTION("Unsatisfiable") {
+        // Pigeonhole: 3 pigeons, 2 holes, p{i}{j} is variable 2 * i + j + 1
+        std::ofstream("test_import.cnf") << "p cnf 6 9\n"
+                                            "1 2 0\n3 4 0\n5 6 0\n"
+                                            "-1 -3 0\n-1 -5 0\n-3 -5 0\n"
+                                            "-2 -4 0\n-2 -6 0\n-4 -6 0\n";
+        interp.feed("load_cnf \"test_import.cnf\" as f;");
+        REQUIRE(!interp.is_sat("f"));
+
+        std::ofstream("test_import.cnf") << "p cnf 2 2\n1 0\n0\n2 0\n";
+        interp.feed("load_cnf \"test_import.cnf\" as g;");
+        REQUIRE(!interp.is_sat("g"));
+    }
+
+    SECTION("Malformed Files") {
+        interp.feed("load_cnf \"no_such_file.cnf\" as f;");
+        REQUIRE(absl::StrContains(interp.get_output(), "Failed to open file"));
+
+        std::ofstream("test_import.cnf") << "p cnf 2 1\n1 x 0\n";
+        interp.feed("load_cnf \"test_import.cnf\" as f;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "test_import.cnf:2: Expected a literal"));
+
+        std::ofstream("test_import.cnf") << "p cnf 2 1\n1 2\n";
+        interp.feed("load_cnf \"test_import.cnf\" as f;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Clause not terminated by 0"));
+
+        std::ofstream("test_import.cnf") << "1 2 0\n";
+        interp.feed("load_cnf \"test_import.cnf\" as f;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Clause before problem line"));
+
+        std::ofstream("test_import.cnf") << "p cnf 2 3\n1 2 0\n-1 0\n";
+        interp.feed("load_cnf \"test_import.cnf\" as f;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Expected 3 clauses but found 2"));
+
+        std::ofstream("test_import.cnf") << "p cnf 2 1\n1 3 0\n";
+        interp.feed("load_cnf \"test_import.cnf\" as f;");
+        REQUIRE(absl::StrContains(
+            interp.get_output(),
+            "test_import.cnf:2: Variable 3 exceeds the problem line's 2"));
+    }
+
+    SECTION("Variables Are Declared As They Are Used") {
+        std::ofstream("test_import.cnf") << "p cnf 2000000000 1\n2 -1 0\n";
+        interp.feed("load_cnf \"test_import.cnf\" as f;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Loaded 1 clauses over 2 variables"));
+        interp.feed("set g = v3;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Variable not found: v3"));
+    }
+
+    SECTION("Targets Must Not Be Variables") {
+        std::ofstream("test_import.cnf") << "p cnf 1 1\n1 0\n";
+        interp.feed("bvar f; load_cnf \"test_import.cnf\" as f;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "assigning to symbolic variable"));
+    }
+    std::remove("test_import.cnf");
+}
+
+TEST_CASE("Circuit Import") {
+    InterpTester interp;
+    // A half adder whose carry is duplicated with swapped fanins:
+    // 6 = a & b, 8 = !a & !b, 10 = !6 & !8 (a xor b) and 12 = b & a
+    const std::string half_adder_gates = "6 2 4\n8 3 5\n10 7 9\n12 4 2\n";
+    const std::string half_adder_symbols = "i0 a\ni1 b\no0 sum\no1 carry\nc\n";
+
+    SECTION("ASCII AIGER") {
+        std::ofstream("test_circuit.aag")
+            << "aag 6 2 0 3 4\n2\n4\n10\n6\n12\n" + half_adder_gates +
+                   half_adder_symbols + "made by hand\n";
+        interp.feed("load_aiger \"test_circuit.aag\" as ha;");
+        const std::string output = interp.get_output();
+        // The duplicate carry gate is merged by structural hashing
+        REQUIRE(absl::StrContains(output,
+                                  "Loaded circuit with 2 inputs, 3 gates and 3 "
+                                  "outputs from test_circuit.aag"));
+        REQUIRE(absl::StrContains(output, "Assigned to ha.sum"));
+        REQUIRE(interp.expr_tree_repr("ha.sum") ==
+                interp.expr_tree_repr("a != b"));
+        REQUIRE(interp.expr_tree_repr("ha.carry") ==
+                interp.expr_tree_repr("a & b"));
+        REQUIRE(interp.interpret_expr("ha.o2") ==
+                interp.interpret_expr("ha.carry"));
+    }
+
+    SECTION("Binary AIGER") {
+        // Gates are implicit and stored as deltas from their left hand side
+        std::ofstream("test_circuit.aig", std::ios::binary)
+            << "aig 6 2 0 3 4\n10\n6\n12\n"
+            << std::string("\x02\x02\x03\x02\x01\x02\x08\x02", 8)
+            << half_adder_symbols;
+        interp.feed("load_aiger \"test_circuit.aig\" as ha;");
+        REQUIRE(absl::StrContains(interp.get_output(), "3 gates"));
+        REQUIRE(interp.expr_tree_repr("ha.sum") ==
+                interp.expr_tree_repr("a != b"));
+        REQUIRE(interp.expr_tree_repr("ha.carry") ==
+                interp.expr_tree_repr("a & b"));
+        std::remove("test_circuit.aig");
+    }
+
+    SECTION("Binary AIGER Without Outputs") {
+        // The gates follow the header directly
+        std::ofstream("test_circuit.aig", std::ios::binary)
+            << "aig 3 2 0 0 1\n" << std::string("\x02\x02", 2)
+            << "i0 a\ni1 b\n";
+        interp.feed("load_aiger \"test_circuit.aig\" as none;");
+        const std::string output = interp.get_output();
+        REQUIRE(absl::StrContains(output, "Loaded circuit with 2 inputs"));
+        REQUIRE_FALSE(absl::StrContains(output, "Malformed"));
+        std::remove("test_circuit.aig");
+    }
+
+    SECTION("BLIF") {
+        std::ofstream("test_circuit.blif") << ".model full_adder\n"
+                                              ".inputs a b \\\n"
+                                              "  cin  # continued\n"
+                                              ".outputs s cout nand zero\n"
+                                              ".names t cin s\n10 1\n01 1\n"
+                                              ".names a b t\n10 1\n01 1\n"
+                                              ".names a b cin cout\n"
+                                              "11- 1\n1-1 1\n-11 1\n"
+                                              ".names a b nand\n11 0\n"
+                                              ".names zero\n"
+                                              ".end\n";
+        interp.feed("load_blif \"test_circuit.blif\" as fa;");
+        REQUIRE(absl::StrContains(interp.get_output(), "4 outputs"));
+        REQUIRE(interp.expr_tree_repr("fa.s") ==
+                interp.expr_tree_repr("(a != b) != cin"));
+        REQUIRE(interp.expr_tree_repr("fa.cout") ==
+                interp.expr_tree_repr("a & b | a & cin | b & cin"));
+        REQUIRE(interp.expr_tree_repr("fa.nand") ==
+                interp.expr_tree_repr("!(a & b)"));
+        REQUIRE(!interp.is_sat("fa.zero"));
+        std::remove("test_circuit.blif");
+    }
+
+    SECTION("Inputs Are Ordered Depth First From The Outputs") {
+        // The first output only depends on the second input
+        std::ofstream("test_circuit.aag") << "aag 2 2 0 2 0\n2\n4\n4\n2\n";
+        interp.feed("load_aiger \"test_circuit.aag\" as c;");
+        REQUIRE(interp.expr_tree_repr("i0 & i1").starts_with("i1 ?"));
+    }
+
+    SECTION("Equivalence Checking Across Formats") {
+        std::ofstream("test_circuit.aag")
+            << "aag 6 2 0 3 4\n2\n4\n10\n6\n12\n" + half_adder_gates +
+                   half_adder_symbols;
+        std::ofstream("test_circuit.blif") << ".inputs a b\n.outputs sum\n"
+                                              ".names a b sum\n00 0\n11 0\n";
+        interp.feed("load_aiger test_circuit.aag as spec;");
+        interp.feed("load_blif test_circuit.blif as impl;");
+        REQUIRE(!interp.is_sat("spec.sum != impl.sum"));
+        std::remove("test_circuit.blif");
+    }
+
+    SECTION("Memory Follows The File, Not max_var") {
+        std::ofstream("test_circuit.aag")
+            << "aag 2147483647 1 0 1 1\n2\n2000000000\n2000000000 2 3\n";
+        interp.feed("load_aiger \"test_circuit.aag\" as big;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Loaded circuit with 1 inputs"));
+        REQUIRE(interp.expr_tree_repr("big.o0") ==
+                interp.expr_tree_repr("false"));
+    }
+
+    SECTION("Unsupported And Malformed Netlists") {
+        std::ofstream("test_circuit.aag") << "aag 3 1 1 1 0\n2\n4 2\n4\n";
+        interp.feed("load_aiger \"test_circuit.aag\" as c;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Sequential circuits are not supported"));
+
+        std::ofstream("test_circuit.aag")
+            << "aag 3 1 0 1 2\n2\n4\n4 6 2\n6 4 2\n";
+        interp.feed("load_aiger \"test_circuit.aag\" as c;");
+        REQUIRE(absl::StrContains(interp.get_output(), "Combinational cycle"));
+
+        std::ofstream("test_circuit.aag") << "aag 3 1 0 1 1\n2\n4\n4 6 2\n";
+        interp.feed("load_aiger \"test_circuit.aag\" as c;");
+        REQUIRE(absl::StrContains(interp.get_output(), "undefined var 3"));
+
+        // Deltas beyond 32 bits are rejected rather than truncated
+        std::ofstream("test_circuit.aig", std::ios::binary)
+            << "aig 3 2 0 0 1\n"
+            << std::string("\x80\x80\x80\x80\x12\x02", 6);
+        interp.feed("load_aiger \"test_circuit.aig\" as c;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "gate delta too large"));
+        std::remove("test_circuit.aig");
+
+        std::ofstream("test_circuit.blif") << ".inputs a\n.outputs y\n"
+                                              ".names a x y\n11 1\n";
+        interp.feed("load_blif \"test_circuit.blif\" as c;");
+        REQUIRE(absl::StrContains(interp.get_output(),
+                                  "Undefined signal in BLIF: x"));
+        std::remove("test_circuit.blif");
+    }
+    std::remove("test_circuit.aag");
+}
+
+TEST_CASE("Allocation Counting") {
+    if (!alloc_stats::enabled()) SKIP("built without BDD_COUNT_ALLOCATIONS");
+
+    SECTION("Counts Allocations And Frees") {
+        const Alloc_Snapshot before = alloc_stats::snapshot();
+        auto block = std::make_unique<std::array<char, 100>>();
+        const Alloc_Snapshot during = alloc_stats::snapshot();
+        REQUIRE(during.allocations == before.allocations + 1);
+        REQUIRE(during.bytes == before.bytes + 100);
+        REQUIRE(during.live_bytes == before.live_bytes + 100);
+        block.reset();
+        REQUIRE(alloc_stats::snapshot().live_bytes == before.live_bytes);
+    }
+
+    SECTION("Per Statement Profile") {
+        InterpTester interp;
+        interp.feed("profile_on; bvar x y z; set a = (x & y) | z;");
+        const auto& profile = interp.get_walker().get_profile();
+        REQUIRE(profile.size() == 2);
+        REQUIRE(profile[1].allocations > 0);
+        REQUIRE(profile[1].allocated_bytes > 0);
+        REQUIRE(profile[1].peak_heap_bytes > 0);
+
+        interp.feed("profile_report;");
+        REQUIRE(absl::StrContains(interp.get_output(), "peak heap"));
+    }
+}
+
+TEST_CASE("Tracing") {
+    // Trace_Span is a no-op unless enable_tracing is set, so use the enabled
+    // span directly to check the file format
+    REQUIRE(Tracer::instance().open("test_trace.json"));
+    {
+        const Basic_Trace_Span<true> apply_span{"apply_and", "bdd"};
+        Basic_Trace_Span<true> stmt_span{"statement", "walker"};
+        stmt_span.annotate("set \"a\"");
+    }
+    {
+        Basic_Trace_Span<true> control_span{"load", "walker"};
+        control_span.annotate("a\tb\r\x01");
+    }
+    Tracer::instance().close();
+
+    std::ifstream f("test_trace.json");
+    const std::string trace{std::istreambuf_iterator(f), {}};
+    REQUIRE(absl::StartsWith(trace, "[\n{\"name\":\"statement\""));
+    REQUIRE(absl::StrContains(trace, R"("args":{"detail":"set \"a\""})"));
+    REQUIRE(absl::StrContains(trace, R"({"name":"apply_and","cat":"bdd")"));
+    REQUIRE(absl::StrContains(trace, R"("detail":"a\u0009b\u000d\u0001")"));
+    REQUIRE(absl::EndsWith(trace, "}\n]\n"));
+    f.close();
+    std::remove("test_trace.json");
+}